@@ -273,6 +273,7 @@ builder:add_option( 'toolchain', 'specifies toolchain to use (auto=search for us
 builder:add_option( 'optram', 'enables Lua Tiny RAM enhancements', true )
 builder:add_option( 'boot', 'boot mode, standard will boot to shell, luarpc boots to an rpc server', 'standard', { 'standard' , 'luarpc' } )
 builder:add_option( 'romfs', 'ROMFS compilation mode', 'verbatim', { 'verbatim' , 'compress', 'compile' } )
+builder:add_option( 'romfs_gzip', 'also store gzip compressed copies of the web text files in ROMFS', false )
 builder:add_option( 'cpumode', 'ARM CPU compilation mode (only affects certain ARM targets)', nil, { 'arm', 'thumb' } )
 builder:init( args )
 builder:set_build_mode( builder.BUILD_DIR_LINEARIZED )
@@ -464,7 +465,7 @@ local function make_romfs()
     table.insert( flist, romfs[ sample ] )
   end
   flist = utils.linearize_array( flist )  
-  if not mkfs.mkfs( romdir, "romfiles", flist, comp.romfs, fscompcmd ) then return -1 end
+  if not mkfs.mkfs( romdir, "romfiles", flist, comp.romfs, fscompcmd, comp.romfs_gzip ) then return -1 end
   if utils.is_file( "inc/romfiles.h" ) then
     -- Read both the old and the new file
     local oldfile = io.open( "inc/romfiles.h", "rb" )
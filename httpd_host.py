@@ -0,0 +1,64 @@
+import os, sys
+
+# Linux build of the web server (src/webserver, src/uip and Lua) on a TAP
+# device, to measure it without a board:
+#
+#   scons -f httpd_host.py [docroot=<dir>]
+#   sudo ./httpd_host httpd0 &
+#   sudo ip addr add 192.168.77.1/24 dev httpd0 && sudo ip link set httpd0 up
+#   python httpd_load.py
+#
+# "scons -f httpd_host.py json_bench" builds the json.stringify / json.write
+# / CBOR benchmark.
+#
+# The server is 192.168.77.10, the files are read from docroot (the pages of
+# test/webserver-fs by default) instead of /mmc.
+
+docroot = os.path.abspath( ARGUMENTS.get( 'docroot', 'test/webserver-fs' ) )
+output = 'httpd_host'
+
+lua_files = """lapi.c lcode.c ldebug.c ldo.c ldump.c lfunc.c lgc.c llex.c lmem.c lobject.c lopcodes.c
+  lparser.c lstate.c lstring.c ltable.c ltm.c lundump.c lvm.c lzio.c lauxlib.c lbaselib.c
+  ldblib.c liolib.c lmathlib.c loslib.c ltablib.c lstrlib.c loadlib.c linit.c lrotable.c legc.c"""
+web_files = "httpd.c httpd-fs.c httpd-uip.c httpd-strings.c httpd-lua.c httpd-tpl.c httpd-url.c httpd-route.c httpd-ws.c httpd-stats.c httpd-cache.c luajson_lib.c luacbor_lib.c"
+uip_files = "uip_arp.c uip.c uiplib.c dhcpc.c psock.c resolv.c"
+host_files = "main.c platform_host.c"
+bench_files = "json_bench.c json_legacy.c"
+
+full_files = " ".join( [ "src/lua/%s" % name for name in lua_files.split() ] )
+full_files = full_files + " " + " ".join( [ "src/webserver/%s" % name for name in web_files.split() ] )
+full_files = full_files + " " + " ".join( [ "src/uip/%s" % name for name in uip_files.split() ] )
+full_files = full_files + " " + " ".join( [ "httpd_host_src/%s" % name for name in host_files.split() ] )
+full_files = full_files + " src/romfs.c src/newlib/genstd.c src/modules/pd.c"
+# no linit.c: the benchmark opens its libraries itself
+bench_full_files = " ".join( [ "src/lua/%s" % name for name in lua_files.split() if name != "linit.c" ] )
+bench_full_files = bench_full_files + " src/webserver/luajson_lib.c src/webserver/luacbor_lib.c"
+bench_full_files = bench_full_files + " " + " ".join( [ "httpd_host_src/%s" % name for name in bench_files.split() ] )
+local_include = "-Ihttpd_host_src -Isrc/webserver -Isrc/uip -Isrc/lua -Iinc -Iinc/newlib -Isrc/modules"
+cdefs = "-DLUA_CROSS_COMPILER -DLUA_OPTIMIZE_MEMORY=0 -DFILE_NAME_PREFIX=\\\"%s\\\"" % docroot
+
+# The board code is not warning free with the host compiler, hence -w for
+# it; the web server itself is built with -Wall
+cccom = "gcc -O2 -g -w -include httpd_host_src/host_pre.h %s %s -c $SOURCE -o $TARGET" % ( local_include, cdefs )
+web_cccom = cccom.replace( " -w ", " -Wall " )
+linkcom = "gcc -o $TARGET $SOURCES -lm"
+# the benchmark counts the heap calls
+bench_linkcom = "gcc -Wl,--wrap=malloc,--wrap=realloc,--wrap=free -o $TARGET $SOURCES -lm"
+
+# An empty ROM file system: everything comes from docroot
+if not GetOption( 'clean' ):
+  import mkfs
+  mkfs.mkfs( "romfs", "romfiles", [], "verbatim", "" )
+  if os.path.exists( "httpd_host_src/romfiles.h" ):
+    os.remove( "httpd_host_src/romfiles.h" )
+  os.rename( "romfiles.h", "httpd_host_src/romfiles.h" )
+
+# Env for building the program
+comp = Environment( CCCOM = cccom,
+                    LINKCOM = linkcom,
+                    ENV = os.environ )
+objs = dict( [ ( name, comp.Object( name, CCCOM = web_cccom if name.startswith( "src/webserver/" ) else cccom ) )
+               for name in set( Split( full_files + " " + bench_full_files ) ) ] )
+Decider( 'MD5' )
+Default( comp.Program( output, [ objs[ name ] for name in Split( full_files ) ] ) )
+comp.Program( 'json_bench', [ objs[ name ] for name in Split( bench_full_files ) ], LINKCOM = bench_linkcom )
@@ -0,0 +1,15 @@
+// Included before every file of the host build: the newlib names the web
+// server uses, mapped to glibc
+
+#ifndef __HOST_PRE_H__
+#define __HOST_PRE_H__
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <sys/types.h>
+
+typedef ssize_t _ssize_t;
+typedef off_t _off_t;
+#define _file _fileno
+
+#endif // #ifndef __HOST_PRE_H__
@@ -0,0 +1,12 @@
+// Host side of the web server host build
+
+#ifndef __HTTPD_HOST_H__
+#define __HTTPD_HOST_H__
+
+// Default name of the TAP device
+#define HOST_TAP_NAME         "httpd0"
+
+int host_eth_open( const char *ifname );
+void host_redirect_stdout( void );
+
+#endif // #ifndef __HTTPD_HOST_H__
@@ -0,0 +1,207 @@
+// json.stringify benchmark: the implementation of luajson_lib.c against
+// the one it replaced (json_legacy.c), the pieces json.write() sends, and
+// the same in CBOR (httpd.write()), on the documents the web server
+// encodes. Reports the time and the heap
+// calls (malloc, realloc, free, Lua's own included) per call.
+//
+//   scons -f httpd_host.py json_bench && ./json_bench [milliseconds]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <lua.h>
+#include <lauxlib.h>
+#include <lualib.h>
+#include "lrotable.h"
+#include "luajson_lib.h"
+#include "luacbor_lib.h"
+
+// No ROM tables: linit.c is left out
+const luaR_table lua_rotable[] = { { NULL, NULL } };
+
+int JSON_stringify_legacy( lua_State *L );
+
+// Heap calls, counted by the linker wrappers (-Wl,--wrap=...)
+static unsigned long heap_calls;
+
+void *__real_malloc( size_t size );
+void *__real_realloc( void *ptr, size_t size );
+void __real_free( void *ptr );
+
+void *__wrap_malloc( size_t size )
+{
+  heap_calls ++;
+  return __real_malloc( size );
+}
+
+void *__wrap_realloc( void *ptr, size_t size )
+{
+  heap_calls ++;
+  return __real_realloc( ptr, size );
+}
+
+void __wrap_free( void *ptr )
+{
+  if( ptr )
+    heap_calls ++;
+  __real_free( ptr );
+}
+
+// The documents, as global tables of the same name
+static const char *docs[] = { "reqdata", "sensors", "series", "text" };
+static const char *docs_src =
+  "json = {}\n"
+  "reqdata = { a = '1', b = 'x y', led = 'on' }\n"
+  "sensors = {}\n"
+  "for i = 1, 8 do sensors[ 'adc' .. i ] = { value = i * 37, min = 0, max = 1023, hist = { 1, 2, 4, 8, 16, 32, 64, 128 } } end\n"
+  "series = {}\n"
+  "for i = 1, 1000 do series[ i ] = i * 0.25 - 100 end\n"
+  "text = {}\n"
+  "for i = 1, 50 do text[ i ] = 'line ' .. i .. ': \"quoted\", a\\\\b\\tc\\n' end\n";
+
+// The document in pieces of the size of the web server output buffer, as
+// json.write() sends it. Returns its length, or its text once joined.
+static int join;
+static const JSONFormat *format = &JSON_text;
+
+static int json_write_pieces( lua_State *L )
+{
+  char out[ 1024 ], *text = NULL;
+  size_t len, total = 0;
+  const char *err;
+  int done;
+
+  lua_settop( L, 1 );
+  JSON_write_begin( L, format );
+  do
+  {
+    done = JSON_write_step( L, 1, out, sizeof( out ), &len, &err );
+    if( join )
+    {
+      text = realloc( text, total + len );
+      memcpy( text + total, out, len );
+    }
+    total += len;
+  } while( !done );
+  if( err != NULL )
+    return luaL_error( L, "%s", err );
+  if( !join )
+  {
+    lua_pushnumber( L, total );
+    return 1;
+  }
+  lua_pushlstring( L, text, total );
+  free( text );
+  return 1;
+}
+
+static double now_us()
+{
+  struct timespec ts;
+
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+  return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+// The text of f for doc
+static const char *text_of( lua_State *L, lua_CFunction f, const char *doc, size_t *len )
+{
+  lua_pushcfunction( L, f );
+  lua_getglobal( L, doc );
+  lua_call( L, 1, 1 );
+  return lua_tolstring( L, -1, len );
+}
+
+// The legacy encoder writes some values another way (numeric strings as
+// numbers): the two texts are shown when they differ
+static void compare_legacy( lua_State *L, const char *doc )
+{
+  size_t llen, nlen, i;
+  const char *legacy = text_of( L, JSON_stringify_legacy, doc, &llen );
+  const char *text = text_of( L, JSON_stringify, doc, &nlen );
+
+  for( i = 0; i < llen && i < nlen && legacy[ i ] == text[ i ]; i ++ )
+    ;
+  if( i < llen || i < nlen )
+  {
+    printf( "%s: legacy text differs at byte %lu, %lu bytes against %lu\n", doc,
+            ( unsigned long )i, ( unsigned long )llen, ( unsigned long )nlen );
+    if( llen <= 72 && nlen <= 72 )
+      printf( "  legacy %s\n  new    %s\n", legacy, text );
+  }
+  lua_pop( L, 2 );
+}
+
+// Calls f on the document for at least ms milliseconds
+static void run( lua_State *L, const char *name, lua_CFunction f, const char *doc, double ms )
+{
+  unsigned long n = 0, calls;
+  double start, elapsed;
+  size_t len;
+
+  lua_pushcfunction( L, f );
+  lua_getglobal( L, doc );
+  // once to get the size, and to warm up
+  lua_pushvalue( L, -2 );
+  lua_pushvalue( L, -2 );
+  lua_call( L, 1, 1 );
+  len = lua_type( L, -1 ) == LUA_TNUMBER ? ( size_t )lua_tonumber( L, -1 ) : lua_objlen( L, -1 );
+  lua_pop( L, 1 );
+
+  lua_gc( L, LUA_GCCOLLECT, 0 );
+  calls = heap_calls;
+  start = now_us();
+  do
+  {
+    lua_pushvalue( L, -2 );
+    lua_pushvalue( L, -2 );
+    lua_call( L, 1, 1 );
+    lua_pop( L, 1 );
+    n ++;
+  } while( ( elapsed = now_us() - start ) < ms * 1000 );
+  printf( "%-8s %-8s %7lu bytes %10.2f us %8.1f heap calls\n", doc, name, ( unsigned long )len,
+          elapsed / n, ( double )( heap_calls - calls ) / n );
+  lua_pop( L, 2 );
+}
+
+int main( int argc, char **argv )
+{
+  double ms = argc > 1 ? atof( argv[ 1 ] ) : 500;
+  lua_State *L = luaL_newstate();
+  unsigned i;
+
+  lua_pushcfunction( L, luaopen_base );
+  lua_call( L, 0, 0 );
+  lua_pushcfunction( L, luaopen_string );
+  lua_call( L, 0, 0 );
+  if( luaL_dostring( L, docs_src ) )
+  {
+    fprintf( stderr, "%s\n", lua_tostring( L, -1 ) );
+    return 1;
+  }
+  for( i = 0; i < sizeof( docs ) / sizeof( docs[ 0 ] ); i ++ )
+  {
+    // the pieces make the text of json.stringify
+    join = 1;
+    lua_pushcfunction( L, json_write_pieces );
+    lua_getglobal( L, docs[ i ] );
+    lua_call( L, 1, 1 );
+    lua_pushcfunction( L, JSON_stringify );
+    lua_getglobal( L, docs[ i ] );
+    lua_call( L, 1, 1 );
+    if( !lua_equal( L, -1, -2 ) )
+      printf( "%s: json.write text differs\n", docs[ i ] );
+    lua_pop( L, 2 );
+    join = 0;
+    compare_legacy( L, docs[ i ] );
+    run( L, "legacy", JSON_stringify_legacy, docs[ i ], ms );
+    run( L, "new", JSON_stringify, docs[ i ], ms );
+    run( L, "write", json_write_pieces, docs[ i ], ms );
+    format = &CBOR_format;
+    run( L, "cbor", json_write_pieces, docs[ i ], ms );
+    format = &JSON_text;
+  }
+  lua_close( L );
+  return 0;
+}
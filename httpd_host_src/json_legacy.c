@@ -0,0 +1,373 @@
+// json.stringify as it was before the rewrite in luajson_lib.c, kept for
+// json_bench.c to compare with. Do not use: it leaks a list node per
+// table, and numeric strings come out as numbers. The only change: the
+// result is copied to L before the string state is closed, the original
+// moved it across states and used it after it was freed.
+
+#include <lua.h>
+#include <lauxlib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef unsigned int BOOL;
+#define TRUE  1
+#define FALSE 0
+
+static char int2digit(const int val)
+{
+    if (val >= 10)
+        return 'a' + val - 10;
+    else
+        return '0' + val;
+}
+
+static void int2fourhex(int num, char * buf)
+{
+    buf[0] = int2digit(num / 4096);
+    num %= 4096;
+    buf[1] = int2digit(num / 256);
+    num %= 256;
+    buf[2] = int2digit(num / 16);
+    num %= 16;
+    buf[3] = int2digit(num);
+    buf[4] = 0;
+}
+
+static char * quote(const char * S, int len)
+{
+    const char * c = S;
+    int count = 2 + len;    // final string size, excluding zero terminator
+    while (c < S + len)
+    {
+        switch (*c)
+        {
+        case '\\':
+        case '"':
+        case '\b':
+        case '\f':
+        case '\n':
+        case '\r':
+        case '\t':
+            count++;
+            break;
+        default:
+            if (*c < 32)
+                count += 5;
+            break;
+        }
+        c++;
+    }
+    // count complete, allocate and recreate string.
+    char * newS = malloc(sizeof(char) * (count + 1)); // add null terminator
+    char * newc = newS;
+    newc[0] = '"';
+    newc[1] = 'a';
+    newc[2] = 'b';
+    newc[3] = 'c';
+    newc++;
+    c = S;
+    while (c < S + len)
+    {
+        switch (*c)
+        {
+        case '\\':
+            newc[0] = '\\';
+            newc[1] = '\\';
+            newc += 2;
+            break;
+        case '"':
+            newc[0] = '\\';
+            newc[1] = '"';
+            newc += 2;
+            break;
+        case '\b':
+            newc[0] = '\\';
+            newc[1] = 'b';
+            newc += 2;
+            break;
+        case '\f':
+            newc[0] = '\\';
+            newc[1] = 'f';
+            newc += 2;
+            break;
+        case '\n':
+            newc[0] = '\\';
+            newc[1] = 'n';
+            newc += 2;
+            break;
+        case '\r':
+            newc[0] = '\\';
+            newc[1] = 'r';
+            newc += 2;
+            break;
+        case '\t':
+            newc[0] = '\\';
+            newc[1] = 't';
+            newc += 2;
+            break;
+        default:
+            if (*c < 32)
+            {
+                newc[0] = '\\';
+                newc[1] = 'u';
+                newc += 2;
+                int2fourhex(*c, newc);
+                newc += 4;
+            }
+            else
+            {
+                newc[0] = *c;
+                newc++;
+            }
+            break;
+        }
+        c++;
+    }
+    newc[0] = '"';
+    newc[1] = 0;
+    return newS;
+}
+
+typedef struct {void * value; struct s_linkedList * next;} linkedList;
+
+static void addToList(void * Value, linkedList * L)
+{
+    if (L == NULL)
+    {
+        L = malloc(sizeof(linkedList));
+        L->value = Value;
+        L->next = NULL;
+    }
+    else
+    {
+        if (L->next != NULL)
+        {
+            addToList(Value, (linkedList *)L->next);
+        }
+        else
+        {
+            linkedList * newL = (linkedList *)malloc(sizeof(linkedList));
+            L->next = (struct s_linkedList *)newL;
+            newL->value = Value;
+            newL->next = NULL;
+        }
+    }
+}
+
+static linkedList * findInList(linkedList * L, void * Match)
+{
+    linkedList * ptr;
+    linkedList * match = NULL;
+    for (ptr = L; ptr != NULL; ptr = (linkedList *)ptr->next)
+    {
+        if (ptr->value == Match)
+        {
+            match = ptr;
+            break;
+        }
+    }
+    return match;
+}
+
+static void removeLastFromList(linkedList * L, linkedList * Last)
+{
+    if (L == NULL)
+    {
+        return;
+    }
+    if (L->next == NULL)
+    {
+        free(L);
+        if (Last != NULL)
+        {
+            Last->next = NULL;
+        }
+    }
+    else
+        removeLastFromList((linkedList *)L->next, L);
+}
+
+static linkedList * baseList;
+
+/// -0 +0
+static void stringifyBoolean(lua_State *L, const int value, luaL_Buffer *StringBuf)
+{
+    luaL_addstring(StringBuf, value?"true":"false");
+}
+
+/// -0 +0
+static void stringifyNull(lua_State *L, luaL_Buffer *StringBuf)
+{
+    luaL_addstring(StringBuf, "null");
+}
+
+/// -0 +0
+static void stringifyNumber(lua_State *L, const double value, luaL_Buffer *StringBuf)
+{
+    char s[32];
+    sprintf(s, "%.14g", value);
+    luaL_addstring(StringBuf, s);
+}
+
+/// -0 +0
+static void stringifyString(lua_State *L, const char * S, const int len, luaL_Buffer *StringBuf)
+{
+    char * quote_s = quote(S, len);
+    luaL_addstring(StringBuf, quote_s);
+    free(quote_s);
+}
+
+static void stringify(lua_State *L, luaL_Buffer *StringBuf);
+
+/// Takes a table at the top of the stack, and appends it, stringified, to StringBuf.
+static void stringifyTable(lua_State *L, luaL_Buffer *StringBuf)
+{
+    void * tablePtr = (void *)lua_topointer(L, -1); // -0 +0
+    linkedList * foundMatch = findInList(baseList, tablePtr);
+    if (!foundMatch)
+    {
+        addToList(tablePtr, baseList);
+        lua_checkstack(L, 6);
+        lua_pushnumber(L, 1); // -0 +1
+        lua_gettable(L, -2);  // -1 +1
+        if (lua_isnil(L, -1))   // No t[1], treat as object.
+        {
+            lua_pop(L, 1);  // -1 +0
+            luaL_addchar(StringBuf, '{');
+            lua_getglobal(L, "pairs"); // -0 +1
+            lua_pushvalue(L, -2);   // -0 +1
+            lua_call(L, 1, 3);  // -2 +3 pairs(t), three return-values put on stack
+            BOOL first = TRUE;
+            while (1)
+            {
+                lua_pushvalue(L, -3);   // -0 +1
+                lua_pushvalue(L, -3);   // -0 +1
+                lua_pushvalue(L, -3);   // -0 +1
+                lua_remove(L, -4);   // -1 +0
+                lua_call(L, 2, 2);  // -3 +2 calling the iterator function, getting key,value
+                if (lua_isnil(L, -2))
+                {
+                    lua_pop(L, 4); // -4+0
+                    break;
+                }
+                else if (!lua_isstring(L, -2))
+                {
+                    lua_pop(L, 1); // -1+0
+                    continue;
+                }
+                if (!first)
+                    luaL_addchar(StringBuf, ',');
+                else
+                    first = FALSE;
+                lua_pushvalue(L, -2);   // -0 +1
+                stringify(L, StringBuf); // -1 +0
+                luaL_addchar(StringBuf, ':');   // -0 +0
+                stringify(L, StringBuf); // -1 +0
+            }
+            luaL_addchar(StringBuf, '}');
+        }
+        else    // t[1] exists, treat as array.
+        {
+            lua_pop(L, 1);  // -1 +0
+            luaL_addchar(StringBuf, '[');
+            lua_getglobal(L, "ipairs"); // -0+1
+            lua_pushvalue(L, -2);   // -0+1
+            lua_call(L, 1, 3);  // -2+3 ipairs(t), three return-values put on stack
+            BOOL first = TRUE;
+            while (1)
+            {
+                lua_pushvalue(L, -3);   // -0+1
+                lua_pushvalue(L, -3);   // -0+1
+                lua_pushvalue(L, -3);   // -0+1
+                lua_remove(L, -4);   // -1+0
+                lua_call(L, 2, 2);  // -3+2 calling the iterator function, getting key,value
+                if (lua_isnil(L, -2))
+                {
+                    lua_pop(L, 4); // -4+0
+                    break;
+                }
+                if (!first)
+                    luaL_addchar(StringBuf, ',');
+                else
+                    first = FALSE;
+                stringify(L, StringBuf); // -1 +0
+            }
+            luaL_addchar(StringBuf, ']');
+        }
+        removeLastFromList(baseList, NULL);
+    }
+    else
+    {
+        printf("RECURSION\n");
+        luaL_addstring(StringBuf, "RECURSION");
+    }
+}
+
+/// Takes the value at the top of L's stack, and appends it to StringBuf.
+/// -1 +0
+static void stringify(lua_State *L, luaL_Buffer *StringBuf)
+{
+    if (lua_isboolean(L, -1))
+    {
+        int B = lua_toboolean(L, -1);   // -0 +0
+        stringifyBoolean(L, B, StringBuf);  // -0 +0
+    }
+    else if (lua_isnumber(L, -1))
+    {
+        double N = lua_tonumber(L, -1); // -0 +0
+        stringifyNumber(L, N, StringBuf);   // -0 +0
+    }
+    else if (lua_isstring(L, -1))
+    {
+    	size_t len;
+        const char * s = lua_tolstring(L, -1, &len);    // -0 +0
+        stringifyString(L, s, len, StringBuf);  // -0 +0
+    }
+    else if (lua_istable(L, -1))
+    {
+        lua_checkstack(L, 2);
+        lua_getglobal(L, "json");   // -0 +1
+        lua_getfield(L, -1, "null");    // -0 +1
+        if (lua_equal(L, -3, -1))
+        {
+            lua_pop(L, 2);  // -2 +0
+            stringifyNull(L, StringBuf);    // -0 +0
+        }
+        else
+        {
+            lua_pop(L, 2);  // -2 +0
+            stringifyTable(L, StringBuf);   // -0 +0
+        }
+    }
+    else
+    {
+        if (lua_isfunction(L, -1))
+            luaL_addstring(StringBuf, "FUNCTION");
+        else if (lua_isuserdata(L, -1))
+            luaL_addstring(StringBuf, "USERDATA");
+        else if (lua_isnil(L, -1))
+            luaL_addstring(StringBuf, "");
+        else
+            luaL_addstring(StringBuf, "wtf?");
+    }
+    lua_pop(L, 1); // -1 +0
+}
+
+int JSON_stringify_legacy(lua_State *L)
+{
+    lua_State * Strings = lua_open(); // Lua state which will hold the string buffer stack.
+    luaL_Buffer * LBuf = malloc(sizeof(luaL_Buffer));
+    luaL_buffinit(Strings, LBuf); // This one.
+    lua_settop(L, 1);   // Only take the first argument.
+    stringify(L, LBuf); // -1 +0
+    luaL_pushresult(LBuf);  // -0 +1
+    free(LBuf);
+    {
+        size_t len;
+        const char * res = lua_tolstring(Strings, -1, &len);
+        lua_pushlstring(L, res, len);
+    }
+    lua_close(Strings);
+    return 1;
+}
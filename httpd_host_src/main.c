@@ -0,0 +1,29 @@
+// Web server host build: uIP and the web server on a Linux TAP device
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "type.h"
+#include "uip.h"
+#include "httpd.h"
+#include "httpd_host.h"
+
+int main( int argc, char **argv )
+{
+  struct uip_eth_addr mac = { { 0x02, 0x00, 0x00, 0x00, 0x00, 0x0a } };
+  const char *ifname = argc > 1 ? argv[ 1 ] : HOST_TAP_NAME;
+
+  if( host_eth_open( ifname ) < 0 )
+  {
+    perror( "cannot open the TAP device" );
+    return 1;
+  }
+  fprintf( stderr, "httpd: %s, 192.168.77.10 (the host side is 192.168.77.1)\n", ifname );
+  host_redirect_stdout();
+  http_uip_init( &mac );
+  httpd_init();
+  // the main loop sleeps when it has nothing to do
+  while( 1 )
+    httpd_uip_mainloop();
+  return 0;
+}
@@ -0,0 +1,59 @@
+// eLua platform configuration of the web server host build
+
+#ifndef __PLATFORM_CONF_H__
+#define __PLATFORM_CONF_H__
+
+#include "auxmods.h"
+#include "type.h"
+
+// *****************************************************************************
+// Define here what components you want for this platform
+
+#define BUILD_CON_GENERIC
+#define BUILD_WEB_SERVER
+#define BUILD_MMCFS
+#define BUILD_ROMFS
+
+// As many clients as the boards
+#define WEB_MAX_CLIENT        4
+
+#define CON_UART_ID           0
+
+#define ELUA_CPU              HOST
+#define ELUA_BOARD            HTTPD_HOST
+#define ELUA_PLATFORM         LINUX
+
+// *****************************************************************************
+// Auxiliary libraries that will be compiled for this platform
+
+#define LUA_PLATFORM_LIBS_ROM\
+  _ROM( AUXLIB_PD, luaopen_pd, pd_map )\
+  _ROM( AUXLIB_JSON, luaopen_json, json_map )\
+  _ROM( AUXLIB_CBOR, luaopen_cbor, cbor_map )
+
+// *****************************************************************************
+// Configuration data
+
+// Static TCP/IP configuration, the host end of the TAP device is
+// 192.168.77.1
+#define ELUA_CONF_IPADDR0     192
+#define ELUA_CONF_IPADDR1     168
+#define ELUA_CONF_IPADDR2     77
+#define ELUA_CONF_IPADDR3     10
+
+#define ELUA_CONF_NETMASK0    255
+#define ELUA_CONF_NETMASK1    255
+#define ELUA_CONF_NETMASK2    255
+#define ELUA_CONF_NETMASK3    0
+
+#define ELUA_CONF_DEFGW0      192
+#define ELUA_CONF_DEFGW1      168
+#define ELUA_CONF_DEFGW2      77
+#define ELUA_CONF_DEFGW3      1
+
+#define ELUA_CONF_DNS0        192
+#define ELUA_CONF_DNS1        168
+#define ELUA_CONF_DNS2        77
+#define ELUA_CONF_DNS3        1
+
+#endif // #ifndef __PLATFORM_CONF_H__
@@ -0,0 +1,187 @@
+// Platform layer of the web server host build: Ethernet on a TAP device,
+// the console on stderr, a microsecond timer and the newlib glue the web
+// server expects
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/time.h>
+#include <sys/ioctl.h>
+#include <sys/select.h>
+#include <sys/stat.h>
+#include <net/if.h>
+#include <linux/if_tun.h>
+#include "type.h"
+#include "platform.h"
+#include "devman.h"
+#include "genstd.h"
+#include "httpd_host.h"
+
+static int tap_fd = -1;
+static u64 last_ms, next_tick_ms;
+
+// The system timer of the boards, 4 Hz, which wakes the main loop up
+#define HOST_TICK_MS          250
+
+// devman globals used by romfs
+struct dm_dirent dm_shared_dirent;
+char dm_shared_fname[ DM_MAX_FNAME_LENGTH + 1 ];
+
+static u64 host_now_ms()
+{
+  struct timespec ts;
+
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+  return ( u64 )ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// ****************************************************************************
+// Ethernet
+
+int host_eth_open( const char *ifname )
+{
+  struct ifreq ifr;
+
+  if( ( tap_fd = open( "/dev/net/tun", O_RDWR ) ) < 0 )
+    return -1;
+  memset( &ifr, 0, sizeof( ifr ) );
+  ifr.ifr_flags = IFF_TAP | IFF_NO_PI;
+  strncpy( ifr.ifr_name, ifname, IFNAMSIZ - 1 );
+  if( ioctl( tap_fd, TUNSETIFF, &ifr ) < 0 )
+  {
+    close( tap_fd );
+    tap_fd = -1;
+    return -1;
+  }
+  fcntl( tap_fd, F_SETFL, O_NONBLOCK );
+  last_ms = host_now_ms();
+  return tap_fd;
+}
+
+// Block until a frame arrives or 'ms' elapse
+static void host_eth_wait( unsigned ms )
+{
+  fd_set rfds;
+  struct timeval tv;
+
+  FD_ZERO( &rfds );
+  FD_SET( tap_fd, &rfds );
+  tv.tv_sec = ms / 1000;
+  tv.tv_usec = ( ms % 1000 ) * 1000;
+  select( tap_fd + 1, &rfds, NULL, NULL, &tv );
+}
+
+void platform_eth_send_packet( const void* src, u32 size, u8 endframe )
+{
+  if( write( tap_fd, src, size ) < 0 )
+    perror( "tap write" );
+}
+
+u32 platform_eth_get_packet_nb( void* buf, u32 maxlen )
+{
+  ssize_t len = read( tap_fd, buf, maxlen );
+
+  return len > 0 ? ( u32 )len : 0;
+}
+
+void platform_eth_force_interrupt()
+{
+}
+
+u32 platform_eth_get_elapsed_time()
+{
+  u64 now = host_now_ms();
+  u32 elapsed = ( u32 )( now - last_ms );
+
+  last_ms = now;
+  return elapsed;
+}
+
+void platform_eth_idle()
+{
+  u64 now = host_now_ms();
+
+  if( now >= next_tick_ms )
+  {
+    next_tick_ms = now + HOST_TICK_MS;
+    return;
+  }
+  host_eth_wait( ( unsigned )( next_tick_ms - now ) );
+}
+
+u32 platform_eth_get_clock_us()
+{
+  struct timespec ts;
+
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+  return ( u32 )( ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000 );
+}
+
+// ****************************************************************************
+// Timer: microseconds of the host clock, whatever the id
+
+u32 platform_timer_op( unsigned id, int op, u32 data )
+{
+  struct timeval tv;
+
+  gettimeofday( &tv, NULL );
+  return ( u32 )( tv.tv_sec * 1000000ULL + tv.tv_usec );
+}
+
+u32 platform_timer_get_diff_us( unsigned id, timer_data_type end, timer_data_type start )
+{
+  return end - start;
+}
+
+// ****************************************************************************
+// Console and CPU
+
+void platform_uart_send( unsigned id, u8 data )
+{
+  fputc( data, stderr );
+}
+
+int platform_cpu_set_global_interrupts( int status )
+{
+  return 0;
+}
+
+int platform_cpu_get_global_interrupts()
+{
+  return 0;
+}
+
+// ****************************************************************************
+// newlib glue
+
+int _fstat_r( struct _reent *r, int fd, struct stat *st )
+{
+  int res = fstat( fd, st );
+
+  if( res < 0 )
+    r->_errno = errno;
+  return res;
+}
+
+// stdout goes through the std device, as newlib's device manager does on
+// the target, so print() in a script reaches its HTTP connection
+static ssize_t host_stdout_write( void *cookie, const char *buf, size_t len )
+{
+  struct _reent r;
+  const DM_DEVICE *pdev = std_get_desc();
+
+  return pdev->p_write_r( &r, DM_STDOUT_NUM, buf, len );
+}
+
+void host_redirect_stdout()
+{
+  cookie_io_functions_t fns = { NULL, host_stdout_write, NULL, NULL };
+  FILE *fp = fopencookie( NULL, "w", fns );
+
+  setvbuf( fp, NULL, _IONBF, 0 );
+  stdout = fp;
+}
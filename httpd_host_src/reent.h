@@ -0,0 +1,13 @@
+// The part of newlib's reent.h used by the web server, on top of the host libc
+
+#ifndef __HOST_REENT_H__
+#define __HOST_REENT_H__
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+struct _reent { int _errno; };
+
+int _fstat_r( struct _reent *r, int fd, struct stat *st );
+
+#endif // #ifndef __HOST_REENT_H__
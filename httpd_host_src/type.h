@@ -0,0 +1,23 @@
+// Type definitions for the web server host build
+
+#ifndef __TYPE_H__
+#define __TYPE_H__
+
+#include <stdint.h>
+
+typedef int8_t s8;
+typedef uint8_t u8;
+typedef int16_t s16;
+typedef uint16_t u16;
+typedef int32_t s32;
+typedef uint32_t u32;
+typedef int64_t s64;
+typedef uint64_t u64;
+typedef unsigned int BOOL;
+
+#ifndef TRUE
+#define TRUE  1
+#define FALSE 0
+#endif
+
+#endif // #ifndef __TYPE_H__
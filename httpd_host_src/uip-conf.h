@@ -0,0 +1,155 @@
+//*****************************************************************************
+//
+// uip-conf.h - uIP Project Specific Configuration File (web server host build)
+//
+//*****************************************************************************
+
+#ifndef __UIP_HOST_CONF_H__
+#define __UIP_HOST_CONF_H__
+
+#include "platform_conf.h"
+
+//
+// 8 bit datatype
+// This typedef defines the 8-bit type used throughout uIP.
+//
+typedef unsigned char u8_t;
+
+//
+// 16 bit datatype
+// This typedef defines the 16-bit type used throughout uIP.
+//
+typedef unsigned short u16_t;
+
+//
+// Statistics datatype
+// This typedef defines the dataype used for keeping statistics in
+// uIP.
+//
+typedef unsigned long uip_stats_t;
+
+//
+// Ping IP address assignment
+// Use first incoming "ping" packet to derive host IP address
+//
+#define UIP_CONF_PINGADDRCONF       0
+
+// 
+// TCP support on or off
+//
+#define UIP_CONF_TCP                1
+
+//
+// UDP support on or off
+//
+#define UIP_CONF_UDP                1
+
+//
+// UDP checksums on or off
+// (not currently supported ... should be 0)
+//
+#define UIP_CONF_UDP_CHECKSUMS      1
+
+//
+// UDP Maximum Connections
+//
+#define UIP_CONF_UDP_CONNS          4
+
+//
+// Maximum number of TCP connections.
+//
+#define UIP_CONF_MAX_CONNECTIONS    (WEB_MAX_CLIENT)
+
+//
+// Maximum number of listening TCP ports.
+//
+#define UIP_CONF_MAX_LISTENPORTS    1
+
+//
+// Size of advertised receiver's window
+//
+//#define UIP_CONF_RECEIVE_WINDOW     400
+
+//
+// Size of ARP table
+//
+#define UIP_CONF_ARPTAB_SIZE        4
+
+//
+// uIP buffer size.
+//
+#define UIP_CONF_BUFFER_SIZE        (1024*1)
+
+//
+// uIP statistics on or off
+// On: the load generator reads the segments sent from httpd.stats()
+//
+#define UIP_CONF_STATISTICS         1
+
+//
+// Logging on or off
+//
+#define UIP_CONF_LOGGING            0
+
+//
+// Broadcast Support
+//
+#define UIP_CONF_BROADCAST          1
+
+//
+// Link-Level Header length
+//
+#define UIP_CONF_LLH_LEN            14
+
+//
+// CPU byte order.
+//
+#define UIP_CONF_BYTE_ORDER         UIP_LITTLE_ENDIAN
+
+//
+// Here we include the header file for the application we are using in
+// this example
+#include "elua_uip.h"
+#include "dhcpc.h"
+#include "httpd.h"
+
+//
+// Define the uIP Application State type (both TCP and UDP)
+//
+
+#ifdef BUILD_UIP
+typedef struct elua_uip_state uip_tcp_appstate_t;
+#endif
+#ifdef BUILD_WEB_SERVER
+typedef struct httpd_state uip_tcp_appstate_t;
+#endif
+
+typedef struct dhcpc_state uip_udp_appstate_t;
+
+//
+// UIP_APPCALL: the name of the application function. This function
+// must return void and take no arguments (i.e., C type "void
+// appfunc(void)").
+//
+
+#ifndef UIP_APPCALL
+#ifdef BUILD_WEB_SERVER
+#define UIP_APPCALL                 httpd_appcall
+#else
+#define UIP_APPCALL                 elua_uip_appcall
+#endif
+#endif
+
+#ifndef UIP_ADP_APPCALL
+#ifdef BUILD_WEB_SERVER
+#define UIP_UDP_APPCALL             http_uip_udp_appcall
+#else
+#define UIP_UDP_APPCALL             elua_uip_udp_appcall
+#endif
+#endif
+
+// Added for eLua: DHCP TIMER ID
+#define ELUA_DHCP_TIMER_ID          1
+#define CLOCK_SECOND                1000000UL
+
+#endif // __UIP_CONF_H_
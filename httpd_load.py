@@ -0,0 +1,234 @@
+# Load generator of the web server: a mix of requests sent over a few
+# persistent connections, then the throughput, the latencies, the TCP
+# segments per response and the high-water marks of the server.
+#
+#   python httpd_load.py [-c conns] [-n requests | -t seconds] [-m mix] [-j]
+#
+# The mix is a list of path=weight, requests go in that proportion and in
+# the same order from run to run. With -j the result is one JSON object,
+# to keep as a baseline. See httpd_host.py to run the server on a PC.
+
+from __future__ import print_function
+import sys, socket, threading, time, json, getopt
+
+host = "192.168.77.10"
+port = 80
+conns = 4
+total = 2000
+duration = 0
+as_json = False
+mix = "/logo.png=2,/index.pht=2,/test.lua=2,/json.pht?a=1&b=x=2,/404.html=1"
+
+# One response of a connection; returns ( status, body, closed )
+def _read_response( sock, buf ):
+  while b"\r\n\r\n" not in buf[ 0 ]:
+    data = sock.recv( 4096 )
+    if not data:
+      raise IOError( "connection closed" )
+    buf[ 0 ] += data
+  head, rest = buf[ 0 ].split( b"\r\n\r\n", 1 )
+  lines = head.decode( "latin-1" ).split( "\r\n" )
+  status = int( lines[ 0 ].split()[ 1 ] )
+  hdrs = {}
+  for l in lines[ 1: ]:
+    k, v = l.split( ":", 1 )
+    hdrs[ k.strip().lower() ] = v.strip()
+  closed = hdrs.get( "connection", "" ).lower() == "close"
+  if "content-length" in hdrs:
+    size = int( hdrs[ "content-length" ] )
+    while len( rest ) < size:
+      data = sock.recv( 4096 )
+      if not data:
+        raise IOError( "connection closed" )
+      rest += data
+    buf[ 0 ] = rest[ size: ]
+    return status, rest[ :size ], closed
+  if hdrs.get( "transfer-encoding", "" ).lower() == "chunked":
+    body = b""
+    while True:
+      while b"\r\n" not in rest:
+        rest += sock.recv( 4096 )
+      line, rest = rest.split( b"\r\n", 1 )
+      n = int( line.split( b";" )[ 0 ], 16 )
+      while len( rest ) < n + 2:
+        data = sock.recv( 4096 )
+        if not data:
+          raise IOError( "connection closed" )
+        rest += data
+      body += rest[ :n ]
+      rest = rest[ n + 2: ]
+      if n == 0:
+        buf[ 0 ] = rest
+        return status, body, closed
+  # up to the end of the connection
+  while True:
+    data = sock.recv( 4096 )
+    if not data:
+      break
+    rest += data
+  buf[ 0 ] = b""
+  return status, rest, True
+
+def _connect():
+  sock = socket.create_connection( ( host, port ), 10 )
+  sock.setsockopt( socket.IPPROTO_TCP, socket.TCP_NODELAY, 1 )
+  return sock
+
+# A single request on its own connection
+def get( path ):
+  sock = _connect()
+  sock.sendall( ( "GET %s HTTP/1.1\r\nHost: %s\r\nConnection: close\r\n\r\n" % ( path, host ) ).encode( "latin-1" ) )
+  status, body, closed = _read_response( sock, [ b"" ] )
+  sock.close()
+  return body
+
+# The counters of the server, {} if it does not give them
+def server_stats():
+  try:
+    return json.loads( get( "/_stats" ).decode( "latin-1" ) )
+  except ( ValueError, IOError, socket.error ):
+    sys.stderr.write( "warning: no statistics from %s/_stats\n" % host )
+    return {}
+
+class Run:
+  def __init__( self, paths ):
+    self.paths = paths
+    self.next = 0
+    self.lock = threading.Lock()
+    self.lat = dict( [ ( p, [] ) for p in set( paths ) ] )
+    self.status = {}
+    self.bytes = 0
+    self.errors = 0
+    self.reconnects = 0
+    self.stop = None
+
+  # the next path to ask for, None at the end
+  def take( self ):
+    with self.lock:
+      if self.stop is not None and time.time() >= self.stop:
+        return None
+      if self.stop is None and self.next >= total:
+        return None
+      p = self.paths[ self.next % len( self.paths ) ]
+      self.next += 1
+      return p
+
+  def done( self, path, t, status, size ):
+    with self.lock:
+      self.lat[ path ].append( t )
+      self.status[ status ] = self.status.get( status, 0 ) + 1
+      self.bytes += size
+
+  def worker( self ):
+    sock, buf = None, [ b"" ]
+    while True:
+      path = self.take()
+      if path is None:
+        break
+      try:
+        if sock is None:
+          sock, buf = _connect(), [ b"" ]
+        t = time.time()
+        sock.sendall( ( "GET %s HTTP/1.1\r\nHost: %s\r\n\r\n" % ( path, host ) ).encode( "latin-1" ) )
+        status, body, closed = _read_response( sock, buf )
+        self.done( path, time.time() - t, status, len( body ) )
+        if closed:
+          sock.close()
+          sock = None
+          self.reconnects += 1
+      except ( IOError, socket.error ):
+        with self.lock:
+          self.errors += 1
+        if sock is not None:
+          sock.close()
+        sock = None
+    if sock is not None:
+      sock.close()
+
+def _percentile( v, p ):
+  if not v:
+    return 0
+  v = sorted( v )
+  return v[ min( len( v ) - 1, int( len( v ) * p / 100.0 ) ) ]
+
+def _ms( t ):
+  return round( t * 1000, 3 )
+
+def main():
+  global host, port, conns, total, duration, as_json, mix
+  opts, args = getopt.getopt( sys.argv[ 1: ], "h:p:c:n:t:m:j" )
+  for o, v in opts:
+    if o == "-h": host = v
+    elif o == "-p": port = int( v )
+    elif o == "-c": conns = int( v )
+    elif o == "-n": total = int( v )
+    elif o == "-t": duration = float( v )
+    elif o == "-m": mix = v
+    elif o == "-j": as_json = True
+
+  # the weights spread evenly: a=2,b=1 gives a b a
+  weights = []
+  for item in mix.split( "," ):
+    path, w = item.rsplit( "=", 1 )
+    weights.append( ( path, int( w ) ) )
+  paths = []
+  for i in range( max( [ w for p, w in weights ] ) ):
+    paths += [ p for p, w in weights if w > i ]
+
+  run = Run( paths )
+  before = server_stats()
+  start = time.time()
+  if duration > 0:
+    run.stop = start + duration
+  threads = [ threading.Thread( target = run.worker ) for i in range( conns ) ]
+  for t in threads:
+    t.start()
+  for t in threads:
+    t.join()
+  elapsed = time.time() - start
+  after = server_stats()
+
+  every = []
+  for p in run.lat:
+    every += run.lat[ p ]
+  res = {
+    "connections": conns,
+    "requests": len( every ),
+    "errors": run.errors,
+    "reconnects": run.reconnects,
+    "seconds": round( elapsed, 3 ),
+    "requests_per_s": round( len( every ) / elapsed, 1 ) if elapsed > 0 else 0,
+    "bytes": run.bytes,
+    "p50_ms": _ms( _percentile( every, 50 ) ),
+    "p99_ms": _ms( _percentile( every, 99 ) ),
+    "max_ms": _ms( max( every ) if every else 0 ),
+    "status": dict( [ ( str( k ), v ) for k, v in run.status.items() ] ),
+    "heap_hwm_kb": after.get( "heap_hwm" ),
+    "write_hwm": after.get( "write_hwm" ),
+    "paths": {}
+  }
+  # the server counts the segments only if built with UIP_CONF_STATISTICS
+  if "segments" in after and "segments" in before and every:
+    res[ "segments_per_response" ] = round( float( after[ "segments" ] - before[ "segments" ] ) / len( every ), 2 )
+    res[ "rexmit" ] = after[ "rexmit" ] - before[ "rexmit" ]
+  for p in sorted( run.lat ):
+    v = run.lat[ p ]
+    res[ "paths" ][ p ] = { "n": len( v ), "p50_ms": _ms( _percentile( v, 50 ) ),
+                            "p99_ms": _ms( _percentile( v, 99 ) ), "max_ms": _ms( max( v ) if v else 0 ) }
+
+  if as_json:
+    print( json.dumps( res, sort_keys = True ) )
+    return
+  print( "%d requests in %.2f s over %d connections: %.1f req/s, %d errors, %d reconnects" %
+         ( res[ "requests" ], res[ "seconds" ], conns, res[ "requests_per_s" ], res[ "errors" ], res[ "reconnects" ] ) )
+  print( "latency p50 %.2f ms, p99 %.2f ms, max %.2f ms" % ( res[ "p50_ms" ], res[ "p99_ms" ], res[ "max_ms" ] ) )
+  if "segments_per_response" in res:
+    print( "segments per response %.2f, %d retransmitted" % ( res[ "segments_per_response" ], res[ "rexmit" ] ) )
+  print( "heap high-water %s KB, write buffer high-water %s bytes" % ( res[ "heap_hwm_kb" ], res[ "write_hwm" ] ) )
+  print( "status: %s" % ", ".join( [ "%s x%d" % ( k, v ) for k, v in sorted( res[ "status" ].items() ) ] ) )
+  for p in sorted( res[ "paths" ] ):
+    r = res[ "paths" ][ p ]
+    print( "  %-24s %6d  p50 %7.2f  p99 %7.2f  max %7.2f ms" % ( p, r[ "n" ], r[ "p50_ms" ], r[ "p99_ms" ], r[ "max_ms" ] ) )
+
+if __name__ == "__main__":
+  main()
@@ -289,6 +289,13 @@ void platform_eth_send_packet( const void* src, u32 size ,u8 endframe);
 u32 platform_eth_get_packet_nb( void* buf, u32 maxlen );
 void platform_eth_force_interrupt();
 u32 platform_eth_get_elapsed_time();
+// Microseconds since start, modulo 2^32, counted on the system tick: it
+// keeps going while the CPU sleeps and the tmr module cannot restart it
+u32 platform_eth_get_clock_us();
+// Sleep until the next Ethernet or timer interrupt, at once if one came
+// that platform_eth_get_packet_nb or platform_eth_get_elapsed_time has not
+// seen yet
+void platform_eth_idle();
 
 // *****************************************************************************
 // Allocator support
@@ -5,6 +5,7 @@
 
 #include "type.h"
 #include "devman.h"
+#include <time.h>
 
 /*******************************************************************************
 The Read-Only "filesystem" resides in a contiguous zone of memory, with the
@@ -37,6 +38,8 @@ typedef struct
   
 // FS functions
 const DM_DEVICE* romfs_init();
+const u8* romfs_get_file_data( const char* fname, u32* psize );
+time_t romfs_get_file_time();
 
 #endif
 
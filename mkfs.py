@@ -2,6 +2,8 @@
 import os, sys
 import re
 import struct
+import gzip as gz
+import StringIO
 
 _crtline = '  '
 _numdata = 0
@@ -23,6 +25,36 @@ def _add_data( data, outfile, moredata = True ):
     _crtline = '  '
     _numdata = 0
 
+# Extensions of the files that get a gzip compressed copy (see 'gzip' below)
+gzip_ext = [ '.html', '.htm', '.css', '.js', '.txt', '.json', '.svg', '.xml' ]
+
+# Write a file entry: name, size, data
+def _add_file( fname, filedata, outfile ):
+  for c in fname:
+    _add_data( ord( c ), outfile )
+  _add_data( 0, outfile ) # ASCIIZ
+  size_l = len( filedata ) & 0xFF
+  size_h = ( len( filedata ) >> 8 ) & 0xFF
+  _add_data( size_l, outfile )
+  _add_data( size_h, outfile )
+  # Then write the rest of the file
+  for c in filedata:
+    _add_data( ord( c ), outfile )
+
+  # Report
+  print "Encoded file %s (%d bytes)" % ( fname, len( filedata ) )
+
+# Return filedata gzip compressed, or None if it is not smaller
+def _gzip_data( filedata ):
+  buf = StringIO.StringIO()
+  gzfile = gz.GzipFile( fileobj = buf, mode = "wb", compresslevel = 9, mtime = 0 )
+  gzfile.write( filedata )
+  gzfile.close()
+  gzdata = buf.getvalue()
+  if len( gzdata ) < len( filedata ):
+    return gzdata
+  return None
+
 # dirname - the directory where the files are located.
 # outname - the name of the C output
 # flist - list of files
@@ -31,8 +63,11 @@ def _add_data( data, outfile, moredata = True ):
 #   "compile" - precompile all files to Lua bytecode and then copy them
 #   "compress" - keep the source code, but compress it with LuaSrcDiet
 # compcmd - the command to use for compiling if "mode" is "compile"
+# gzip - if True, the files with an extension in 'gzip_ext' are also
+#   stored gzip compressed as <name>.gz (served by the web server to the
+#   clients that accept it)
 # Returns True for OK, False for error
-def mkfs( dirname, outname, flist, mode, compcmd ):
+def mkfs( dirname, outname, flist, mode, compcmd, gzip = False ):
   # Try to create the output files
   outfname = outname + ".h"
   try:
@@ -107,19 +142,12 @@ def mkfs( dirname, outname, flist, mode, compcmd ):
       os.remove( newname )
 
     # Write name, size, id, numpars
-    for c in fname:
-      _add_data( ord( c ), outfile )
-    _add_data( 0, outfile ) # ASCIIZ
-    size_l = len( filedata ) & 0xFF
-    size_h = ( len( filedata ) >> 8 ) & 0xFF
-    _add_data( size_l, outfile )
-    _add_data( size_h, outfile )
-    # Then write the rest of the file
-    for c in filedata:
-      _add_data( ord( c ), outfile )
-    
-    # Report
-    print "Encoded file %s (%d bytes)" % ( fname, len( filedata ) )
+    _add_file( fname, filedata, outfile )
+    # And the compressed copy if requested
+    if gzip and len( fname ) + 3 <= maxlen and os.path.splitext( fname )[ 1 ] in gzip_ext:
+      gzdata = _gzip_data( filedata )
+      if gzdata is not None:
+        _add_file( fname + ".gz", gzdata, outfile )
     
   # All done, write the final "0" (terminator)
   _add_data( 0, outfile, False )
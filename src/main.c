@@ -108,6 +108,7 @@ int main( void )
   dm_register( remotefs_init() );
 
 #ifdef BUILD_WEB_SERVER
+  httpd_init();
   while(1)
     httpd_uip_mainloop();
 
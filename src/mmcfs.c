@@ -13,9 +13,11 @@
 #include "diskio.h"
 #include <fcntl.h>
 #include <sys/stat.h>
+#include <time.h>
 
 #define MMCFS_MAX_FDS   4
 static FIL mmcfs_fd_table[ MMCFS_MAX_FDS ];
+static time_t mmcfs_fd_mtime[ MMCFS_MAX_FDS ];
 static int mmcfs_num_fd;
 
 // Data structures used by FatFs
@@ -27,6 +29,21 @@ static FIL mmc_fileObject;
 #define PATH_BUF_SIZE   40
 static char mmc_pathBuf[PATH_BUF_SIZE];
 
+// Convert a FAT date/time pair to seconds since the Unix epoch
+static time_t mmcfs_fat2time( WORD fdate, WORD ftime )
+{
+  int y = ( fdate >> 9 ) + 1980, m = ( fdate >> 5 ) & 0x0F, d = fdate & 0x1F;
+  long days;
+
+  if( m < 1 || m > 12 || d < 1 )
+    return 0;
+  // Days from civil date (March based year)
+  if( m <= 2 )
+    y --;
+  days = 365L * y + y / 4 - y / 100 + y / 400 + ( 153 * ( m + ( m > 2 ? -3 : 9 ) ) + 2 ) / 5 + d - 1 - 719468L;
+  return ( time_t )days * 86400 + ( ftime >> 11 ) * 3600 + ( ( ftime >> 5 ) & 0x3F ) * 60 + ( ftime & 0x1F ) * 2;
+}
+
 static int mmcfs_find_empty_fd( void )
 {
   int i;
@@ -41,6 +58,7 @@ static int mmcfs_open_r( struct _reent *r, const char *path, int flags, int mode
 {
   int fd;
   int mmc_mode;
+  FILINFO mmc_file_info;
 
   if (mmcfs_num_fd == MMCFS_MAX_FDS)
   {
@@ -97,6 +115,14 @@ static int mmcfs_open_r( struct _reent *r, const char *path, int flags, int mode
     mmc_fileObject.fptr = mmc_fileObject.fsize;
   fd = mmcfs_find_empty_fd();
   memcpy(mmcfs_fd_table + fd, &mmc_fileObject, sizeof(FIL));
+  // Remember the modification time for fstat
+  mmcfs_fd_mtime[fd] = 0;
+#if _USE_LFN
+  mmc_file_info.lfname = NULL;
+  mmc_file_info.lfsize = 0;
+#endif
+  if (f_stat(mmc_pathBuf, &mmc_file_info) == FR_OK)
+    mmcfs_fd_mtime[fd] = mmcfs_fat2time(mmc_file_info.fdate, mmc_file_info.ftime);
   mmcfs_num_fd ++;
   return fd;
 }
@@ -173,6 +199,7 @@ static int mmcfs_fstat_r ( struct _reent *r, int fd, struct stat *st )
 {
   FIL* pFile = mmcfs_fd_table + fd;
   st->st_size = pFile->fsize;
+  st->st_mtime = mmcfs_fd_mtime[fd];
   return 0;
 }
 // opendir
@@ -42,6 +42,9 @@ LUALIB_API int ( luaopen_net )( lua_State *L );
 #define AUXLIB_JSON      "json"
 LUALIB_API int ( luaopen_json )( lua_State *L );
 
+#define AUXLIB_CBOR      "cbor"
+LUALIB_API int ( luaopen_cbor )( lua_State *L );
+
 #define AUXLIB_CPU      "cpu"
 LUALIB_API int ( luaopen_cpu )( lua_State* L );
 
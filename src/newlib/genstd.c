@@ -149,19 +149,17 @@ static _ssize_t uip_write( struct _reent *r, int fd, const void* vptr, size_t le
 	  return len;
   }
 
-  s = get_httpd_state_struct();
-
-  assert((s->write_buffer_len + len) < WRITE_BUFFER_SIZE);
-
-  for(i=0; i < len; i++)
+  // the connection whose handler is running, the console otherwise
+  if( ( s = get_httpd_state_struct() ) == NULL )
   {
-	if(ptr[i] != '\n')
-	  s->write_buffer[s->write_buffer_len + i] = ptr[i];
-	else
-	  len--;
+    http_uart_send_str(ptr, len);
+    return len;
   }
 
-  s->write_buffer_len += len;
+  // print() yields when the buffer is full, other writes are cut
+  i = http_buffer_str(s, ptr, len);
+  if (i < len)
+    fprintf(stderr, "uip_write: output buffer full, %u bytes lost\n", (unsigned)(len - i));
 
   return len;
 }
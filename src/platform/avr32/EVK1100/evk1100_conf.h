@@ -74,7 +74,8 @@
 #endif
 
 #ifdef BUILD_WEB_SERVER
-#define JSON  _ROM( AUXLIB_JSON, luaopen_json, json_map )
+#define JSON  _ROM( AUXLIB_JSON, luaopen_json, json_map )\
+  _ROM( AUXLIB_CBOR, luaopen_cbor, cbor_map )
 #else
 #define JSON
 #endif
@@ -155,6 +155,10 @@ static void vWriteMDIO(volatile avr32_macb_t *macb, unsigned short usAddress, un
 /* Holds the index to the next buffer from which data will be read. */
 volatile unsigned long ulNextRxBuffer = 0;
 
+/* Set by the ISR when a frame has been received; set at first, for the
+frames received before the interrupt was enabled. */
+volatile Bool xMACBRxEvent = TRUE;
+
 
 long lMACBSend(volatile avr32_macb_t *macb, const void *pvFrom, unsigned long ulLength, long lEndOfFrame)
 {
@@ -800,6 +804,7 @@ __attribute__((__interrupt__)) void vMACB_ISR(void)
     // the Rx descriptors.
     AVR32_MACB.rsr =  AVR32_MACB_REC_MASK;  // Clear
     AVR32_MACB.rsr; // Read to force the previous write
+    xMACBRxEvent = TRUE;
   }
 
   if( ulIntStatus & AVR32_MACB_TCOMP_MASK )
@@ -473,6 +473,12 @@ extern void vMACBWaitForInput(unsigned long ulTimeOut);
  * \return the length of the next frame in the receive buffers.
  */
 extern unsigned long ulMACBInputLength(void);
+
+/**
+ * \brief Set by the MACB ISR when a frame has been received, to be cleared
+ * by the reader before it looks at the receive buffers.
+ */
+extern volatile Bool xMACBRxEvent;
 
 /**
  * \brief Set the MACB Physical address (SA1B & SA1T registers).
@@ -46,7 +46,8 @@
 #define SYSTICKMS               (1000 / SYSTICKHZ)
 
 #if defined(BUILD_UIP) || defined(BUILD_WEB_SERVER)
-static int eth_timer_fired;
+static volatile int eth_timer_fired;
+static volatile u32 eth_ticks;
 #endif
 
 // ****************************************************************************
@@ -78,6 +79,7 @@ __attribute__((__interrupt__)) static void tmr_int_handler()
 #if defined(BUILD_UIP) || defined(BUILD_WEB_SERVER)
   // Indicate that a SysTick interrupt has occurred.
   eth_timer_fired = 1;
+  eth_ticks ++;
 #endif
 #ifdef BUILD_UIP
   // Generate a fake Ethernet interrupt.  This will perform the actual work
@@ -729,18 +731,28 @@ u32 platform_eth_get_packet_nb( void* buf, u32 maxlen )
 {
 	u32    len;
 
+    /* No frame came since the buffers were found empty. */
+    if( !xMACBRxEvent )
+        return 0;
+    xMACBRxEvent = FALSE;
+
     /* Obtain the size of the packet. */
     len = ulMACBInputLength();
+    if( len == 0 )
+        return 0;
+    /* Others may follow it. */
+    xMACBRxEvent = TRUE;
 
     if (len > maxlen) {
+        /* Too big for uIP: drop it, else it blocks the ones after it. */
+        vMACBRead( NULL, 0, len );
+        vMACBFlushCurrentPacket( len );
     	return 0;
     }
 
-    if( len ) {
-        /* Let the driver know we are going to read a new packet. */
-    	vMACBRead( NULL, 0, len );
-    	vMACBRead( buf, len, len );
-    }
+    /* Let the driver know we are going to read a new packet. */
+    vMACBRead( NULL, 0, len );
+    vMACBRead( buf, len, len );
 
  return len;
 }
@@ -762,4 +774,53 @@ u32 platform_eth_get_elapsed_time()
     else
       return 0;
 }
+
+u32 platform_eth_get_clock_us()
+{
+#if VTMR_NUM_TIMERS > 0
+    // The ticks counted so far, and the position of the systick channel
+    // in the current one
+    volatile avr32_tc_t *tc = &AVR32_TC;
+    static u64 last;
+    u32 ticks, cnt, clock;
+    u64 now;
+
+    do
+    {
+      ticks = eth_ticks;
+      cnt = tc_read_tc( tc, VTMR_CH );
+    } while( ticks != eth_ticks );
+    now = ( u64 )ticks * tc_read_rc( tc, VTMR_CH ) + cnt;
+    // The counter went back to 0 just before its interrupt ran
+    if( now < last )
+      now += tc_read_rc( tc, VTMR_CH );
+    last = now;
+    clock = platform_timer_get_clock( VTMR_CH );
+    return ( u32 )( ( now / clock ) * 1000000 + ( now % clock ) * 1000000 / clock );
+#else
+    return 0;
+#endif
+}
+
+void platform_eth_idle()
+{
+#if VTMR_NUM_TIMERS > 0
+    // Sleep only when the tick is there to wake the CPU up
+    Disable_global_interrupt();
+    if( xMACBRxEvent || eth_timer_fired )
+    {
+      Enable_global_interrupt();
+      return;
+    }
+#ifdef AVR32_PM_SMODE_GMCLEAR_MASK
+    // Enable the interrupts and sleep at once: one that would come in
+    // between still wakes the CPU up
+    SLEEP( AVR32_PM_SMODE_GMCLEAR_MASK | AVR32_PM_SMODE_IDLE );
+#else
+    // A frame that comes in between waits for the next tick
+    Enable_global_interrupt();
+    SLEEP( AVR32_PM_SMODE_IDLE );
+#endif
+#endif
+}
 #endif
@@ -7,6 +7,7 @@
 #include "romfiles.h"
 #include <stdio.h>
 #include "ioctl.h"
+#include <time.h>
 
 #include "platform_conf.h"
 #ifdef BUILD_ROMFS
@@ -213,6 +214,41 @@ const DM_DEVICE* romfs_init()
   return &romfs_device;
 }
 
+// Direct access to the data of a file (the file system is in memory)
+// Returns NULL if the file is not found
+const u8* romfs_get_file_data( const char* fname, u32* psize )
+{
+  FS tempfs;
+
+  if( romfs_open_file( fname, romfs_read, &tempfs ) != FS_FILE_OK )
+    return NULL;
+  *psize = tempfs.size;
+  return romfiles_fs + tempfs.baseaddr;
+}
+
+// Modification time of the ROMFS files: the time of the build, this file
+// is compiled again each time romfiles.h is generated
+time_t romfs_get_file_time()
+{
+  static const char months[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+  static time_t t;
+  struct tm tm;
+  char mon[ 4 ];
+  const char *p;
+
+  if( t == 0 )
+  {
+    memset( &tm, 0, sizeof( tm ) );
+    sscanf( __DATE__, "%3s %d %d", mon, &tm.tm_mday, &tm.tm_year );
+    sscanf( __TIME__, "%d:%d:%d", &tm.tm_hour, &tm.tm_min, &tm.tm_sec );
+    if( ( p = strstr( months, mon ) ) != NULL )
+      tm.tm_mon = ( p - months ) / 3;
+    tm.tm_year -= 1900;
+    t = mktime( &tm );
+  }
+  return t;
+}
+
 #else // #ifdef BUILD_ROMFS
 
 const DM_DEVICE* romfs_init()
@@ -220,5 +256,15 @@ const DM_DEVICE* romfs_init()
   return NULL;
 }
 
+const u8* romfs_get_file_data( const char* fname, u32* psize )
+{
+  return NULL;
+}
+
+time_t romfs_get_file_time()
+{
+  return 0;
+}
+
 #endif // #ifdef BUILD_ROMFS
 
@@ -299,6 +299,20 @@ PT_THREAD(psock_readto(register struct psock *psock, unsigned char c))
   PT_END(&psock->psockpt);
 }
 /*---------------------------------------------------------------------------*/
+PT_THREAD(psock_readavail(register struct psock *psock))
+{
+  PT_BEGIN(&psock->psockpt);
+
+  if(psock->readlen == 0) {
+    PT_WAIT_UNTIL(&psock->psockpt, psock_newdata(psock));
+    psock->state = STATE_READ;
+    psock->readptr = (u8_t *)uip_appdata;
+    psock->readlen = uip_datalen();
+  }
+
+  PT_END(&psock->psockpt);
+}
+/*---------------------------------------------------------------------------*/
 PT_THREAD(psock_readbuf(register struct psock *psock))
 {
   PT_BEGIN(&psock->psockpt);
@@ -268,6 +268,23 @@ PT_THREAD(psock_readto(struct psock *psock, unsigned char c));
 #define PSOCK_READTO(psock, c)				\
   PT_WAIT_THREAD(&((psock)->pt), psock_readto(psock, c))
 
+PT_THREAD(psock_readavail(struct psock *psock));
+/**
+ * Wait until there is unread data.
+ *
+ * This macro will block waiting for data, which is not copied: it is
+ * left in the readptr and readlen fields of the protosocket for the
+ * application to consume. Used to parse fields that can be longer
+ * than the input buffer.
+ *
+ * \param psock (struct psock *) A pointer to the protosocket from which
+ * data should be read.
+ *
+ * \hideinitializer
+ */
+#define PSOCK_READ_AVAILABLE(psock)			\
+  PT_WAIT_THREAD(&((psock)->pt), psock_readavail(psock))
+
 /**
  * The length of the data that was previously read.
  *
@@ -0,0 +1,195 @@
+/*
+ * Response cache of the web server.
+ *
+ * A script that calls httpd.cache(ms) has its answer kept for ms
+ * milliseconds; the same path with the same parameters is then answered
+ * with the stored bytes, without running it. The responses and their keys
+ * (the path, a zero and the decoded parameters) are in one arena: an
+ * entry takes the first gap big enough, the least recently used ones are
+ * dropped until there is one. An entry being sent stays in place.
+ * The time is the one of the uIP timers, and the expired entries are
+ * dropped as it moves.
+ */
+#include "platform_conf.h"
+#ifdef BUILD_WEB_SERVER
+
+#include <string.h>
+#include "type.h"
+#include "httpd-cache.h"
+
+static char arena[HTTPD_CACHE_SIZE];
+static struct httpd_cache_entry cache[HTTPD_CACHE_NR];
+static unsigned long cache_tick;
+static u32 cache_ms;
+static struct httpd_cache_stats stats;
+
+/*---------------------------------------------------------------------------*/
+/* the entry takes room in the arena */
+static int
+cache_busy(const struct httpd_cache_entry *e)
+{
+  return e->valid || e->users > 0;
+}
+
+/*---------------------------------------------------------------------------*/
+static int
+cache_match(const struct httpd_cache_entry *e, const char *path, size_t pathlen,
+            const struct httpd_url *u)
+{
+  const char *key = arena + e->off;
+
+  return e->keylen == pathlen + 1 + u->paramlen &&
+         memcmp(key, path, pathlen + 1) == 0 &&
+         (u->paramlen == 0 || memcmp(key + pathlen + 1, u->params, u->paramlen) == 0);
+}
+
+/*---------------------------------------------------------------------------*/
+/* Offset of a free gap of size bytes, or -1 */
+static int
+cache_gap(unsigned short size)
+{
+  struct httpd_cache_entry *e;
+  unsigned short off = 0, end;
+  int i, moved;
+
+  /* move past every entry that overlaps [off, off + size) */
+  do {
+    moved = FALSE;
+    for(i = 0; i < HTTPD_CACHE_NR; i++) {
+      e = &cache[i];
+      end = e->off + e->keylen + e->len;
+      if(cache_busy(e) && e->off < off + size && end > off) {
+        off = end;
+        moved = TRUE;
+      }
+    }
+  } while(moved && off + size <= HTTPD_CACHE_SIZE);
+  return off + size <= HTTPD_CACHE_SIZE ? off : -1;
+}
+
+/*---------------------------------------------------------------------------*/
+/* The valid response for path and the parameters of u, NULL if there is
+   none. It must be given back with httpd_cache_put(). */
+struct httpd_cache_entry *
+httpd_cache_get(const char *path, const struct httpd_url *u)
+{
+  struct httpd_cache_entry *e;
+  size_t pathlen = strlen(path);
+  int i;
+
+  for(i = 0; i < HTTPD_CACHE_NR; i++) {
+    e = &cache[i];
+    if(!e->valid || !cache_match(e, path, pathlen, u))
+      continue;
+    if(cache_ms - e->stored >= e->ttl) {
+      e->valid = FALSE;
+      break;
+    }
+    stats.hits++;
+    e->users++;
+    e->used = ++cache_tick;
+    return e;
+  }
+  stats.misses++;
+  return NULL;
+}
+
+/*---------------------------------------------------------------------------*/
+const char *
+httpd_cache_body(const struct httpd_cache_entry *e)
+{
+  return arena + e->off + e->keylen;
+}
+
+/*---------------------------------------------------------------------------*/
+void
+httpd_cache_put(struct httpd_cache_entry *e)
+{
+  if(e != NULL && e->users > 0)
+    e->users--;
+}
+
+/*---------------------------------------------------------------------------*/
+/* Keep body as the response to path with the parameters of u for ttl_ms.
+   Nothing is kept if the arena cannot hold it. */
+void
+httpd_cache_store(const char *path, const struct httpd_url *u,
+                  const char *body, unsigned short len, unsigned long ttl_ms)
+{
+  struct httpd_cache_entry *e, *slot, *victim;
+  size_t pathlen = strlen(path);
+  unsigned long size = pathlen + 1 + u->paramlen + len;
+  int i, off;
+
+  if(u->overflow || size > HTTPD_CACHE_SIZE)
+    return;
+  if(ttl_ms > HTTPD_CACHE_TTL_MAX)
+    ttl_ms = HTTPD_CACHE_TTL_MAX;
+
+  /* the response it replaces goes first */
+  for(i = 0; i < HTTPD_CACHE_NR; i++) {
+    e = &cache[i];
+    if(e->valid && cache_match(e, path, pathlen, u))
+      e->valid = FALSE;
+  }
+
+  while(1) {
+    slot = victim = NULL;
+    for(i = 0; i < HTTPD_CACHE_NR; i++) {
+      e = &cache[i];
+      if(!cache_busy(e)) {
+        if(slot == NULL)
+          slot = e;
+      } else if(e->valid && e->users == 0 && (victim == NULL || e->used < victim->used)) {
+        victim = e;
+      }
+    }
+    if(slot != NULL && (off = cache_gap(size)) >= 0)
+      break;
+    if(victim == NULL)
+      return;
+    victim->valid = FALSE;
+  }
+
+  slot->off = off;
+  slot->keylen = pathlen + 1 + u->paramlen;
+  slot->len = len;
+  memcpy(arena + off, path, pathlen + 1);
+  if(u->paramlen > 0)
+    memcpy(arena + off + pathlen + 1, u->params, u->paramlen);
+  memcpy(arena + off + slot->keylen, body, len);
+  slot->stored = cache_ms;
+  slot->ttl = ttl_ms;
+  slot->used = ++cache_tick;
+  slot->users = 0;
+  slot->valid = TRUE;
+  stats.stores++;
+}
+
+/*---------------------------------------------------------------------------*/
+/* ms went by on the uIP timers. An expired entry is dropped at once, so
+   the age of a valid one is never taken across a wrap of the clock. */
+void
+httpd_cache_tick(u32 ms)
+{
+  struct httpd_cache_entry *e;
+  int i;
+
+  if(ms == 0)
+    return;
+  cache_ms += ms;
+  for(i = 0; i < HTTPD_CACHE_NR; i++) {
+    e = &cache[i];
+    if(e->valid && cache_ms - e->stored >= e->ttl)
+      e->valid = FALSE;
+  }
+}
+
+/*---------------------------------------------------------------------------*/
+const struct httpd_cache_stats *
+httpd_cache_stats(void)
+{
+  return &stats;
+}
+
+#endif
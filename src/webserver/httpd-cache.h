@@ -0,0 +1,45 @@
+#ifndef __HTTPD_CACHE_H__
+#define __HTTPD_CACHE_H__
+
+#include "type.h"
+#include "httpd-url.h"
+
+/* Bytes of the arena holding the cached responses and their keys */
+#ifndef HTTPD_CACHE_SIZE
+#define HTTPD_CACHE_SIZE 4096
+#endif
+
+/* Number of responses kept */
+#ifndef HTTPD_CACHE_NR
+#define HTTPD_CACHE_NR 8
+#endif
+
+/* Longest time to live, in ms; the clock moves by the system tick */
+#define HTTPD_CACHE_TTL_MAX 3600000UL
+
+struct httpd_cache_entry {
+  unsigned short off;           /* in the arena: the key, then the body */
+  unsigned short keylen;
+  unsigned short len;           /* of the body */
+  u32 stored;                   /* clock of the cache when it was stored */
+  u32 ttl;                      /* in ms */
+  unsigned long used;           /* last use, for the LRU replacement */
+  unsigned char users;          /* connections sending it */
+  char valid;                   /* not expired nor replaced */
+};
+
+struct httpd_cache_stats {
+  unsigned long hits;      /* answered without running the script */
+  unsigned long misses;    /* nothing valid for a cacheable request */
+  unsigned long stores;
+};
+
+struct httpd_cache_entry *httpd_cache_get(const char *path, const struct httpd_url *u);
+const char *httpd_cache_body(const struct httpd_cache_entry *e);
+void        httpd_cache_put(struct httpd_cache_entry *e);
+void        httpd_cache_store(const char *path, const struct httpd_url *u,
+                              const char *body, unsigned short len, unsigned long ttl_ms);
+void        httpd_cache_tick(u32 ms);
+const struct httpd_cache_stats *httpd_cache_stats(void);
+
+#endif /* __HTTPD_CACHE_H__ */
@@ -56,170 +56,148 @@
 #include <fcntl.h>
 #include <sys/stat.h>
 
-
-#define ONE_KB (1024)
-#define FILE_HUGE_SIZE   (ONE_KB*300)
-//#define FILE_CACHE_SIZE  (ONE_KB*10)
-#define FILE_CACHE_SIZE  0
-#define FILE_NAME_MAX_SIZE   10
-#define FILE_CACHE_NR    10
-#define FILE_NAME_PREFIX "/mmc"
-
-typedef struct  {
-  char *huge;
-  struct {
-	  char         *data;
-	  char         name[FILE_NAME_MAX_SIZE];
-	  _ssize_t     len;
-  } cache[FILE_CACHE_NR];
-} file_fs_t;
-
-file_fs_t file_fs;
-
-
 /*-----------------------------------------------------------------------------------*/
-int
-httpd_fs_int()
+int httpd_fs_open(const char *name, struct httpd_fs_file *file)
 {
-  int i;
+  FILE                             *fd;
+  char                             fullpath[sizeof(FILE_NAME_PREFIX) + HTTPD_FS_NAME_LEN] = FILE_NAME_PREFIX;
+  struct stat                      fstat_buf;
+  struct                           _reent r; /* it needs a better solution */
+  u32                              romsize;
+
+  file->fd   = NULL;
+  file->rom  = NULL;
+  file->mem  = NULL;
+  file->data = NULL;
+  file->len  = 0;
+  file->pos  = 0;
+  file->mtime = 0;
+  file->fpos = 0;
+
+  /* romfs names have no leading slash */
+  if((file->rom = (const char *)romfs_get_file_data(name + (*name == '/'), &romsize)) != NULL)
+  {
+    file->len = romsize;
+    file->mtime = romfs_get_file_time();
+    return 1;
+  }
 
-  if (file_fs.huge == NULL) {
-    if((file_fs.huge = malloc(FILE_HUGE_SIZE)) == NULL) {
-      fprintf(stderr, "httpd_fs_init(): malloc error\n");
-	  return 1;
-	}
+  /* a longer name is not cut, it would open another file */
+  if(strlen(name) >= HTTPD_FS_NAME_LEN)
+    return 0;
+  strcat(fullpath, name);
+
+  if ((fd = fopen(fullpath, "r" )) == NULL )
+  {
+    fprintf(stderr, "httpd_fs_open(): %s not found.\n",name);
+    return 0;
   }
-  else
-    return 0; /* already initialized */
 
-  for (i = 0; i < FILE_CACHE_NR; i++ ) {
-    if((file_fs.cache[i].data = malloc(FILE_CACHE_SIZE)) == NULL) {
-      fprintf(stderr, "httpd_fs_init(): malloc error\n");
-      return 1;
-    }
-    file_fs.cache[i].name[0] = 0;
-    file_fs.cache[i].len     = 0;
+  memset(&fstat_buf, 0, sizeof(fstat_buf));
+  if(_fstat_r(&r,fileno(fd), &fstat_buf))
+  {
+    fprintf(stderr, "httpd_fs_open(): fstat error in %s.\n",name);
+    fclose(fd);
+    return 0;
   }
 
-  return 0;
+  /* data is read straight into the uIP buffer, no need for a stdio one */
+  setvbuf(fd, NULL, _IONBF, 0);
+
+  file->fd   = fd;
+  file->len  = fstat_buf.st_size;
+  file->mtime = fstat_buf.st_mtime;
+
+  return 1;
 }
 
 /*-----------------------------------------------------------------------------------*/
-int
-httpd_fs_get_free_index()
+unsigned short
+httpd_fs_read(struct httpd_fs_file *file, char *buf, unsigned short len)
 {
-  int i;
+  size_t n;
 
-  for (i = 0; i < FILE_CACHE_NR; i++ ) {
-    if ((file_fs.cache[i].len) == 0)
-      return i;
+  /* romfs: copied straight from flash, no stream involved */
+  if (file->rom != NULL) {
+    memcpy(buf, file->rom + file->pos, len);
+    return len;
   }
 
-  return FILE_CACHE_NR;
-}
-
-/*-----------------------------------------------------------------------------------*/
-int
-httpd_fs_search_name(const char *name)
-{
-  int i;
+  if (file->fd == NULL)
+    return 0;
 
-  for (i = 0; i < FILE_CACHE_NR; i++ ) {
-    if (strcmp(file_fs.cache[i].name,name) == 0)
-      return i;
+  /* a retransmission asks again for the bytes at file->pos */
+  if (file->fpos != file->pos) {
+    if (fseek(file->fd, file->pos, SEEK_SET) != 0) {
+      fprintf(stderr, "httpd_fs_read(): seek error.\n");
+      return 0;
+    }
+    file->fpos = file->pos;
   }
 
-  return FILE_CACHE_NR;
+  n = fread(buf, 1, len, file->fd);
+  file->fpos += n;
+
+  return (unsigned short)n;
 }
 
 /*-----------------------------------------------------------------------------------*/
-
-int httpd_fs_open(const char *name, struct httpd_fs_file *file)
+int
+httpd_fs_load(struct httpd_fs_file *file)
 {
-  FILE                             *fd;
-  char                             fullpath[sizeof(FILE_NAME_PREFIX)+FILE_NAME_MAX_SIZE] = FILE_NAME_PREFIX;
-  struct stat                      fstat_buf;
-  struct                           _reent r; /* it needs a better solution */
-  int                              index;
-
-  file->len = 0;
+  if (file->fd == NULL && file->rom == NULL)
+    return 0;
 
-  if (httpd_fs_int())
+  if (file->len > FILE_LOAD_MAX_SIZE)
   {
-    printf( "httpd_fs_open(): httpd_fs_int() error\n");
+    fprintf(stderr, "httpd_fs_load(): file too big.\n");
     return 0;
   }
 
-  if((index = httpd_fs_search_name(name)) < FILE_CACHE_NR) {
-    file->len  = file_fs.cache[index].len;
-    file->data = file_fs.cache[index].data;
-    return 1;
-  }
-
-  strcat (fullpath, name);
-
-  if ((fd = fopen(fullpath, "r" )) == NULL )
+  if ((file->mem = malloc(file->len + 1)) == NULL)
   {
-    fprintf(stderr, "httpd_fs_open(): %s not found.\n",name);
+    fprintf(stderr, "httpd_fs_load(): malloc error\n");
     return 0;
   }
 
-  if(_fstat_r(&r,fileno(fd), &fstat_buf))
+  if (file->rom != NULL)
   {
-    	  file->len=0; 
-    fprintf(stderr, "httpd_fs_open(): fstat error in %s.\n",name);
-	fclose(fd);
-	return 0;
+    memcpy(file->mem, file->rom, file->len);
+    file->rom = NULL;
   }
-
-  file->len = fstat_buf.st_size;
-
-  if (file->len > FILE_HUGE_SIZE)
+  else if (file->len != fread(file->mem, 1, file->len, file->fd))
   {
-    fprintf(stderr, "httpd_fs_open(): file too big.\n");
-    fclose(fd);
+    fprintf(stderr, "httpd_fs_load(): file size error.\n");
+    httpd_fs_close(file);
     return 0;
   }
+  file->mem[file->len] = 0;
+  file->data = file->mem;
 
-  if (file->len < FILE_CACHE_SIZE)
-  {
-	if((index = httpd_fs_get_free_index()) < FILE_CACHE_NR)
-	{
-      if (file->len != fread(file_fs.cache[index].data,1,file->len,fd))
-      {
-        fprintf(stderr,"httpd_fs_open(): file size error.\n");
-        fclose(fd);
-        return 0;
-      }
-      file_fs.cache[index].data[file->len + 1] = 0;
-      file_fs.cache[index].len = file->len;
-      strcpy(file_fs.cache[index].name,name);
-      file->data = file_fs.cache[index].data;
-	} else {
-      if (file->len != fread(file_fs.huge,1,file->len,fd))
-      {
-        printf( "httpd_fs_open(): file size error.\n");
-        fclose(fd);
-        return 0;
-      }
-      file_fs.huge[file->len + 1] = 0;
-      file->data = file_fs.huge;
-	}
-  } else {
-    if (file->len != fread(file_fs.huge,1,file->len,fd))
-    {
-      fprintf(stderr, "httpd_fs_open(): file size error.\n");
-      fclose(fd);
-      return 0;
-    }
-    file_fs.huge[file->len + 1] = 0;
-    file->data = file_fs.huge;
+  if (file->fd != NULL) {
+    fclose(file->fd);
+    file->fd = NULL;
   }
 
-  fclose(fd);
-
   return 1;
 }
 
+/*-----------------------------------------------------------------------------------*/
+void
+httpd_fs_close(struct httpd_fs_file *file)
+{
+  if (file->fd != NULL) {
+    fclose(file->fd);
+    file->fd = NULL;
+  }
+  if (file->mem != NULL) {
+    free(file->mem);
+    file->mem = NULL;
+  }
+  file->rom  = NULL;
+  file->data = NULL;
+  file->len  = 0;
+}
+
 /*-----------------------------------------------------------------------------------*/
 #endif
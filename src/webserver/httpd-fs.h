@@ -36,17 +36,42 @@
 #define __HTTPD_FS_H__
 
 #include <stdio.h>
+#include <time.h>
+#include "devman.h"
 
+/* Directory of the files that are not in the romfs */
+#ifndef FILE_NAME_PREFIX
+#define FILE_NAME_PREFIX "/mmc"
+#endif
+
+/* Size of a path of the web server: the slash, a name of the file
+   system and the terminator */
+#define HTTPD_FS_NAME_LEN (DM_MAX_FNAME_LENGTH + 2)
+
+/* Largest file httpd_fs_load() will bring into RAM (.pht and .lua pages);
+   everything else is streamed from the open handle. */
+#define FILE_LOAD_MAX_SIZE (16*1024)
 
 struct httpd_fs_file {
-  char *data;
-  size_t len;
+  FILE *fd;      /* open stream, NULL once closed or loaded */
+  const char *rom; /* data of a romfs file, sent straight from flash */
+  char *mem;     /* heap copy made by httpd_fs_load() */
+  char *data;    /* read cursor inside mem */
+  size_t len;    /* bytes still to be sent */
+  size_t pos;    /* file offset of the next byte to be sent */
+  size_t fpos;   /* current offset of the stream */
+  time_t mtime;  /* last modification, 0 if unknown */
 };
 
 /* file must be allocated by caller and will be filled in
-   by the function. */
+   by the function. The romfs is searched first, then the /mmc card. */
 int httpd_fs_open(const char *name, struct httpd_fs_file *file);
-void httpd_fs_init(void);
+/* read up to len bytes at file->pos, file->pos is not moved so the
+   same chunk can be read again for a retransmission */
+unsigned short httpd_fs_read(struct httpd_fs_file *file, char *buf, unsigned short len);
+/* load the whole file in RAM (zero terminated) and close the stream */
+int httpd_fs_load(struct httpd_fs_file *file);
+void httpd_fs_close(struct httpd_fs_file *file);
 int fileno(FILE *stream);
 
 #define fileno(x) (x->_file)
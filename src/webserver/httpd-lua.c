@@ -0,0 +1,697 @@
+/*
+ * Pool of Lua interpreters for the web server.
+ *
+ * Creating an interpreter (lua_open() + luaL_openlibs()) is the biggest
+ * part of the time spent on a dynamic page, so the states are created
+ * once and reset between pages: the libraries (and the rotables) stay
+ * in the original globals table, the scripts get a fresh globals table
+ * that inherits from it.
+ */
+#include "platform_conf.h"
+#ifdef BUILD_WEB_SERVER
+
+#include <stdio.h>
+#include <lua.h>
+#include <lauxlib.h>
+#include <lualib.h>
+#include "lstate.h"     /* httpd_lua_can_yield() only */
+#include "uip.h"
+#include "httpd.h"
+#include "httpd-lua.h"
+#include "httpd-route.h"
+#include "httpd-url.h"
+#include "httpd-tpl.h"
+#include "httpd-stats.h"
+#include "httpd-cache.h"
+#include "httpd-strings.h"
+#include "luajson_lib.h"
+#include "luacbor_lib.h"
+
+/* Registry key of the main thread of a state */
+#define HTTPD_LUA_MAIN "httpd_main"
+
+/* A C function can yield only when called straight from the coroutine,
+   with no C call or metamethod between it and the resume(). Lua 5.1 has
+   no API for this: it reads the private counters of lstate.h, which
+   lua_yield() itself checks, and must follow them in another version. */
+#define httpd_lua_can_yield(L) ((L)->nCcalls <= (L)->baseCcalls)
+
+static struct {
+  lua_State *L;
+  unsigned char users;   /* 0: ready for a new client */
+} pool[HTTPD_LUA_POOL_SIZE];
+
+static struct httpd_lua_pool_stats stats;
+static struct httpd_lua_abort_stats abort_stats;
+
+/*---------------------------------------------------------------------------*/
+/* the connection bound to the thread L, NULL for any other thread */
+static struct httpd_state *
+httpd_lua_bound(lua_State *L)
+{
+  struct httpd_state *s;
+
+  lua_pushlightuserdata(L, L);
+  lua_rawget(L, LUA_REGISTRYINDEX);
+  s = lua_touserdata(L, -1);
+  lua_pop(L, 1);
+  return s;
+}
+
+/*---------------------------------------------------------------------------*/
+/* count hook of a handler: it checks the budget of the request, then the
+   main loop runs before it goes on */
+static void
+httpd_lua_slice(lua_State *L, lua_Debug *ar)
+{
+  struct httpd_state *s;
+
+  (void)ar;
+  if ((s = httpd_lua_conn(L)) == NULL)
+    return;
+  if (!s->overrun) {
+    if (++s->slices > HTTPD_LUA_BUDGET / HTTPD_LUA_SLICE) {
+      s->overrun = HTTPD_LUA_OVER_COUNT;
+      abort_stats.count++;
+    } else if (s->runtime > HTTPD_LUA_TIME_MAX / HTTPD_POLL_MS) {
+      s->overrun = HTTPD_LUA_OVER_TIME;
+      abort_stats.time++;
+    }
+  }
+  if (s->overrun) {
+    /* every instruction fails from now on, so pcall() cannot keep it */
+    lua_sethook(L, httpd_lua_slice, LUA_MASKCOUNT, 1);
+    luaL_error(L, "script aborted: %s budget exceeded",
+               s->overrun == HTTPD_LUA_OVER_COUNT ? "instruction" : "time");
+  }
+  /* a thread of the script itself would return to its resume() */
+  if (httpd_lua_bound(L) == s && httpd_lua_can_yield(L)) {
+    s->runnable = TRUE;
+    lua_yield(L, 0);
+  }
+}
+
+/*---------------------------------------------------------------------------*/
+/* The output of the thread L goes to the connection s, NULL to unbind it.
+   The slot is in the registry of the state, keyed by the thread. A bound
+   thread gives the CPU back every HTTPD_LUA_SLICE instructions. */
+void
+httpd_lua_bind(lua_State *L, struct httpd_state *s)
+{
+  lua_State *M = httpd_lua_main(L);
+
+  lua_pushlightuserdata(M, L);
+  if (s != NULL)
+    lua_pushlightuserdata(M, s);
+  else
+    lua_pushnil(M);
+  lua_rawset(M, LUA_REGISTRYINDEX);
+  if (s != NULL)
+    lua_sethook(L, httpd_lua_slice, LUA_MASKCOUNT, HTTPD_LUA_SLICE);
+  else
+    lua_sethook(L, NULL, 0, 0);
+}
+
+/*---------------------------------------------------------------------------*/
+/* The main thread of the state of L, which stays when a coroutine ends */
+lua_State *
+httpd_lua_main(lua_State *L)
+{
+  lua_State *M;
+
+  lua_getfield(L, LUA_REGISTRYINDEX, HTTPD_LUA_MAIN);
+  M = lua_tothread(L, -1);
+  lua_pop(L, 1);
+  return M;
+}
+
+/*---------------------------------------------------------------------------*/
+/* The connection of the thread L. A thread the script created itself
+   writes to the connection whose script is running. */
+struct httpd_state *
+httpd_lua_conn(lua_State *L)
+{
+  struct httpd_state *s = httpd_lua_bound(L);
+
+  return s != NULL ? s : get_httpd_state_struct();
+}
+
+/*---------------------------------------------------------------------------*/
+/* print() for the pages: the text goes to the connection output buffer.
+   When it does not fit, the script yields the rest, which is sent after
+   the buffer before the script is resumed. */
+static int
+httpd_lua_print(lua_State *L)
+{
+  luaL_Buffer b;
+  int n = lua_gettop(L);
+  int i;
+  size_t len, done;
+  const char *str;
+  struct httpd_state *s;
+
+  lua_getglobal(L, "tostring");
+  luaL_buffinit(L, &b);
+  for (i = 1; i <= n; i++) {
+    lua_pushvalue(L, n + 1);
+    lua_pushvalue(L, i);
+    lua_call(L, 1, 1);
+    if (!lua_isstring(L, -1))
+      return luaL_error(L, LUA_QL("tostring") " must return a string to "
+                           LUA_QL("print"));
+    if (i > 1)
+      luaL_addchar(&b, '\t');
+    luaL_addvalue(&b);
+  }
+  luaL_addchar(&b, '\n');
+  luaL_pushresult(&b);
+
+  str = lua_tolstring(L, -1, &len);
+  if ((s = httpd_lua_conn(L)) == NULL) {
+    /* not answering a request (route script) */
+    fputs(str, stderr);
+    return 0;
+  }
+  done = http_buffer_str(s, str, len);
+  if (done == len)
+    return 0;
+
+  if (!httpd_lua_can_yield(L)) {
+    fprintf(stderr, "print: output buffer full, %u bytes lost\n", (unsigned)(len - done));
+    return 0;
+  }
+  lua_pushlstring(L, str + done, len - done);
+  return lua_yield(L, 1);
+}
+
+/*---------------------------------------------------------------------------*/
+/* httpd.route(pattern, function [, mime]): the function answers pattern,
+   called with the parameters table and the path; nil removes it. A route
+   of C cannot be replaced nor removed. With
+   the mime text/event-stream the answer is open until the function ends,
+   it sends with httpd.event() and waits with httpd.sleep(). */
+static int
+httpd_lua_route(lua_State *L)
+{
+  const char *pattern = luaL_checkstring(L, 1);
+  const char *mime = luaL_optstring(L, 3, NULL);
+
+  if (!lua_isnil(L, 2))
+    luaL_checktype(L, 2, LUA_TFUNCTION);
+  if (!httpd_route_add_lua(L, pattern, 2, mime))
+    return luaL_error(L, "cannot set route %s", pattern);
+  return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/* httpd.websocket(pattern, function): websocket connections on pattern,
+   the function is called with each message and the path; what it prints
+   goes back as one message */
+static int
+httpd_lua_websocket(lua_State *L)
+{
+  const char *pattern = luaL_checkstring(L, 1);
+
+  luaL_checktype(L, 2, LUA_TFUNCTION);
+  if (!httpd_route_add_lua(L, pattern, 2, NULL) || !httpd_route_websocket(pattern))
+    return luaL_error(L, "cannot add websocket %s", pattern);
+  return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/* httpd.event(data [, name]): send a server-sent event right away */
+static int
+httpd_lua_event(lua_State *L)
+{
+  size_t len, size;
+  const char *data = luaL_checklstring(L, 1, &len);
+  const char *name = luaL_optstring(L, 2, NULL);
+  struct httpd_state *s = httpd_lua_conn(L);
+
+  if (s == NULL || !httpd_lua_can_yield(L))
+    return luaL_error(L, "httpd.event: not in a handler");
+  size = http_sse_frame(NULL, name, data, len);
+  http_sse_frame(lua_newuserdata(L, size), name, data, len);
+  lua_pushlstring(L, lua_touserdata(L, -1), size);
+  s->pendraw = TRUE;
+  return lua_yield(L, 1);
+}
+
+/*---------------------------------------------------------------------------*/
+/* httpd.sleep(ms): send the output so far and resume the handler after ms
+   milliseconds, rounded up to the next poll. Without any output for 10 s
+   the connection is aborted, unless it is an event stream. */
+static int
+httpd_lua_sleep(lua_State *L)
+{
+  lua_Number ms = luaL_checknumber(L, 1);
+  struct httpd_state *s = httpd_lua_conn(L);
+
+  if (s == NULL || !httpd_lua_can_yield(L))
+    return luaL_error(L, "httpd.sleep: not in a handler");
+  s->sleep = ms > 0 ? (unsigned short)((ms + HTTPD_POLL_MS - 1) / HTTPD_POLL_MS) : 0;
+  return lua_yield(L, 0);
+}
+
+/*---------------------------------------------------------------------------*/
+/* httpd.cache(ms): the response of this script is answered again for ms
+   milliseconds to the same path and parameters without running it. Only
+   a GET answered in one buffer is kept; 0 keeps nothing. The time is
+   counted in system ticks (250 ms on the boards). */
+static int
+httpd_lua_cache(lua_State *L)
+{
+  lua_Number ms = luaL_checknumber(L, 1);
+  struct httpd_state *s = httpd_lua_conn(L);
+
+  if (s == NULL)
+    return luaL_error(L, "httpd.cache: not in a handler");
+  s->cache_ttl = ms > 0 ? (unsigned long)ms : 0;
+  return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/* httpd.body(): the body of the request as it came, nil if there is none,
+   if it was a form, or if it was bigger than HTTPD_URL_BODY_MAX */
+static int
+httpd_lua_body(lua_State *L)
+{
+  struct httpd_state *s = httpd_lua_conn(L);
+
+  if (s == NULL || s->url.body == NULL)
+    lua_pushnil(L);
+  else
+    lua_pushlstring(L, s->url.body, s->url.bodylen);
+  return 1;
+}
+
+/* the parse of httpd.json(), in a protected call: the text is argument 1,
+   its length argument 2 */
+static int
+httpd_lua_json_parse(lua_State *L)
+{
+  JSON_parse_text(L, lua_touserdata(L, 1), (size_t)lua_tointeger(L, 2), 1);
+  return 1;
+}
+
+/*---------------------------------------------------------------------------*/
+/* httpd.json(): the body of the request parsed as JSON, or nil and a
+   message. The strings are decoded in the block of the body, which is
+   freed after: the body can be read once. */
+static int
+httpd_lua_json(lua_State *L)
+{
+  struct httpd_state *s = httpd_lua_conn(L);
+  int status;
+
+  if (s == NULL || s->url.body == NULL) {
+    lua_pushnil(L);
+    lua_pushliteral(L, "httpd.json: no body, or too big");
+    return 2;
+  }
+  lua_pushcfunction(L, httpd_lua_json_parse);
+  lua_pushlightuserdata(L, s->url.body);
+  lua_pushinteger(L, s->url.bodylen);
+  status = lua_pcall(L, 2, 1, 0);
+  httpd_url_body_free(&s->url);
+  if (status != 0) {
+    lua_pushnil(L);
+    lua_insert(L, -2);
+    return 2;
+  }
+  return 1;
+}
+
+/*---------------------------------------------------------------------------*/
+/* The value at 1 in fmt to the response, written straight in the output
+   buffer. When it does not fit, the handler waits while the rest is sent
+   as it is written. Returns true, or nil and a message if the document
+   was cut (a recursive table, tables nested too deep). */
+static int
+httpd_lua_write_doc(lua_State *L, const JSONFormat *fmt, const char *name)
+{
+  struct httpd_state *s = httpd_lua_bound(L);
+  const char *err;
+
+  if (s == NULL || !httpd_lua_can_yield(L))
+    return luaL_error(L, "%s: not in a handler", name);
+  lua_settop(L, 1);
+  JSON_write_begin(L, fmt);
+  if (!http_buffer_json(s, L, &err)) {
+    /* the server goes on with the document left on the stack */
+    s->pendjson = HTTPD_JSON_WRITING;
+    return lua_yield(L, lua_gettop(L));
+  }
+  if (err != NULL) {
+    lua_pushnil(L);
+    lua_pushstring(L, err);
+    return 2;
+  }
+  lua_pushboolean(L, 1);
+  return 1;
+}
+
+/* json.write(value): value in JSON to the response */
+static int
+httpd_lua_json_write(lua_State *L)
+{
+  return httpd_lua_write_doc(L, &JSON_text, "json.write");
+}
+
+/* httpd.write(value): value in CBOR if the client accepts it, else in
+   JSON, with the Content-type to match. The response depends on the
+   request headers: it is not cached. */
+static int
+httpd_lua_write(lua_State *L)
+{
+  struct httpd_state *s = httpd_lua_bound(L);
+
+  if (s == NULL)
+    return luaL_error(L, "httpd.write: not in a handler");
+  s->content_type = s->accept_cbor ? http_content_type_cbor : http_content_type_json;
+  s->cacheable = FALSE;
+  return httpd_lua_write_doc(L, s->accept_cbor ? &CBOR_format : &JSON_text, "httpd.write");
+}
+
+/*---------------------------------------------------------------------------*/
+/* tmr.delay(id, us) of the handlers: a long delay yields like
+   httpd.sleep(), the others call the original function (upvalue 1) */
+static int
+httpd_lua_delay(lua_State *L)
+{
+  lua_Number us = luaL_checknumber(L, 2);
+  struct httpd_state *s = httpd_lua_bound(L);
+
+  if (s == NULL || us < HTTPD_LUA_DELAY_YIELD || !httpd_lua_can_yield(L)) {
+    lua_pushvalue(L, lua_upvalueindex(1));
+    lua_insert(L, 1);
+    lua_call(L, lua_gettop(L) - 1, 0);
+    return 0;
+  }
+  s->sleep = (unsigned short)((us / 1000 + HTTPD_POLL_MS - 1) / HTTPD_POLL_MS);
+  return lua_yield(L, 0);
+}
+
+/*---------------------------------------------------------------------------*/
+/* {n=, max_us=, ms={...}} of h at the top of the stack */
+static void
+httpd_lua_hist(lua_State *L, const struct httpd_hist *h)
+{
+  int i;
+
+  lua_createtable(L, 0, 3);
+  lua_pushnumber(L, h->n);
+  lua_setfield(L, -2, "n");
+  lua_pushnumber(L, h->max_us);
+  lua_setfield(L, -2, "max_us");
+  lua_createtable(L, HTTPD_STATS_BUCKETS, 0);
+  for (i = 0; i < HTTPD_STATS_BUCKETS; i++) {
+    lua_pushnumber(L, h->b[i]);
+    lua_rawseti(L, -2, i + 1);
+  }
+  lua_setfield(L, -2, "ms");
+}
+
+/* t.name = n, t at the top of the stack */
+static void
+httpd_lua_setnum(lua_State *L, const char *name, lua_Number n)
+{
+  lua_pushnumber(L, n);
+  lua_setfield(L, -2, name);
+}
+
+/*---------------------------------------------------------------------------*/
+/* httpd.stats(): the counters of the server in a table. The histograms
+   count in ms[i] the durations under 2^(i-1) ms. */
+static int
+httpd_lua_stats(lua_State *L)
+{
+  const struct httpd_stats *st = httpd_stats();
+  struct httpd_route *r;
+  struct httpd_state *c;
+  char name[4];
+  int i;
+
+  lua_createtable(L, 0, 16);
+  httpd_lua_setnum(L, "requests", st->requests);
+  httpd_lua_setnum(L, "bytes", st->bytes);
+  httpd_lua_setnum(L, "timeouts", st->timeouts);
+  httpd_lua_setnum(L, "idle", st->idle);
+  httpd_lua_setnum(L, "resets", st->resets);
+  httpd_lua_setnum(L, "write_hwm", st->write_hwm);
+  httpd_lua_setnum(L, "heap_hwm", st->heap_hwm);
+#if UIP_STATISTICS
+  /* of the whole stack, when uIP keeps them */
+  httpd_lua_setnum(L, "segments", uip_stat.tcp.sent);
+  httpd_lua_setnum(L, "rexmit", uip_stat.tcp.rexmit);
+#endif
+
+  lua_createtable(L, 0, 5);
+  for (i = 0; i < 5; i++) {
+    sprintf(name, "%dxx", i + 1);
+    httpd_lua_setnum(L, name, st->status[i]);
+  }
+  lua_setfield(L, -2, "status");
+
+  lua_createtable(L, 0, 2);
+  httpd_lua_setnum(L, "instructions", httpd_lua_abort_stats()->count);
+  httpd_lua_setnum(L, "time", httpd_lua_abort_stats()->time);
+  lua_setfield(L, -2, "aborts");
+
+  lua_createtable(L, 0, 4);
+  httpd_lua_setnum(L, "page_hits", httpd_tpl_stats()->hits);
+  httpd_lua_setnum(L, "page_misses", httpd_tpl_stats()->misses);
+  httpd_lua_setnum(L, "state_hits", stats.hits);
+  httpd_lua_setnum(L, "state_misses", stats.misses);
+  httpd_lua_setnum(L, "response_hits", httpd_cache_stats()->hits);
+  httpd_lua_setnum(L, "response_misses", httpd_cache_stats()->misses);
+  lua_setfield(L, -2, "cache");
+
+  lua_createtable(L, 0, HTTPD_PHASES);
+  for (i = 0; i < HTTPD_PHASES; i++) {
+    httpd_lua_hist(L, &st->phase[i]);
+    lua_setfield(L, -2, httpd_stats_phases[i]);
+  }
+  lua_setfield(L, -2, "phases");
+  httpd_lua_hist(L, &st->pages);
+  lua_setfield(L, -2, "pages");
+  httpd_lua_hist(L, &st->files);
+  lua_setfield(L, -2, "files");
+
+  lua_newtable(L);
+  for (i = 0; i < HTTPD_ROUTE_MAX; i++) {
+    if ((r = httpd_route_get(i)) != NULL && r->pattern != NULL) {
+      httpd_lua_hist(L, &r->hist);
+      lua_setfield(L, -2, r->pattern);
+    }
+  }
+  lua_setfield(L, -2, "routes");
+
+  /* the connections open now */
+  lua_newtable(L);
+  for (i = 0; i < UIP_CONNS; i++) {
+    if (uip_conns[i].tcpstateflags == UIP_CLOSED)
+      continue;
+    c = (struct httpd_state *)&uip_conns[i].appstate;
+    lua_createtable(L, 0, 2);
+    httpd_lua_setnum(L, "write_hwm", c->write_hwm);
+    httpd_lua_setnum(L, "heap_hwm", c->heap_hwm);
+    lua_rawseti(L, -2, lua_objlen(L, -2) + 1);
+  }
+  lua_setfield(L, -2, "connections");
+  return 1;
+}
+
+/*---------------------------------------------------------------------------*/
+/* The module at -2 is read only: the handlers see the global name as a
+   table with the function at -1 as field, in front of the module. Pops
+   the function. */
+static void
+httpd_lua_front(lua_State *L, const char *name, const char *field)
+{
+  lua_createtable(L, 0, 1);
+  lua_insert(L, -2);
+  lua_setfield(L, -2, field);
+  lua_createtable(L, 0, 1);
+  lua_pushvalue(L, -3);
+  lua_setfield(L, -2, "__index");
+  lua_setmetatable(L, -2);
+  lua_setglobal(L, name);
+}
+
+static const luaL_Reg httpd_lua_lib[] = {
+  { "route", httpd_lua_route },
+  { "websocket", httpd_lua_websocket },
+  { "event", httpd_lua_event },
+  { "sleep", httpd_lua_sleep },
+  { "cache", httpd_lua_cache },
+  { "body", httpd_lua_body },
+  { "json", httpd_lua_json },
+  { "write", httpd_lua_write },
+  { "stats", httpd_lua_stats },
+  { NULL, NULL }
+};
+
+/*---------------------------------------------------------------------------*/
+/* A new interpreter with the libraries, print() for the pages and the
+   httpd module */
+lua_State *
+httpd_lua_new(void)
+{
+  lua_State *L;
+
+  if ((L = lua_open()) == NULL) {
+    fprintf(stderr,"cannot create state: not enough memory\n");
+    return NULL;
+  }
+
+  lua_gc(L, LUA_GCSTOP, 0);  /* stop collector during initialization */
+  luaL_openlibs(L);  /* open libraries */
+  lua_gc(L, LUA_GCRESTART, 0);
+
+  lua_pushcfunction(L, httpd_lua_print);
+  lua_setglobal(L, "print");
+  luaL_register(L, "httpd", httpd_lua_lib);
+  lua_pop(L, 1);
+
+  /* the handlers have their own tmr.delay(), and json.write() and
+     json.null */
+  lua_getglobal(L, "tmr");
+  if (!lua_isnil(L, -1)) {
+    lua_getfield(L, -1, "delay");
+    lua_pushcclosure(L, httpd_lua_delay, 1);
+    httpd_lua_front(L, "tmr", "delay");
+  }
+  lua_pop(L, 1);
+  lua_getglobal(L, "json");
+  if (!lua_isnil(L, -1)) {
+    lua_pushcfunction(L, httpd_lua_json_write);
+    httpd_lua_front(L, "json", "write");
+    lua_getglobal(L, "json");
+    lua_pushlightuserdata(L, NULL);
+    lua_setfield(L, -2, "null");
+    lua_pop(L, 1);
+  }
+  lua_pop(L, 1);
+
+  /* keep the globals holding the libraries, the pages get a child of it */
+  lua_pushvalue(L, LUA_GLOBALSINDEX);
+  lua_setfield(L, LUA_REGISTRYINDEX, HTTPD_LUA_BASE_ENV);
+  lua_pushthread(L);
+  lua_setfield(L, LUA_REGISTRYINDEX, HTTPD_LUA_MAIN);
+
+  httpd_lua_reset(L);
+  return L;
+}
+
+/*---------------------------------------------------------------------------*/
+void
+httpd_lua_pool_init(void)
+{
+  int i;
+
+  for (i = 0; i < HTTPD_LUA_POOL_SIZE; i++) {
+    if (pool[i].L == NULL)
+      pool[i].L = httpd_lua_new();
+    pool[i].users = 0;
+  }
+}
+
+/*---------------------------------------------------------------------------*/
+/* Give a fresh globals table to L: whatever the previous page defined is
+   dropped, the libraries are reached through the __index metamethod. */
+void
+httpd_lua_reset(lua_State *L)
+{
+  lua_settop(L, 0);
+
+  lua_newtable(L);                                      /* new globals */
+  lua_createtable(L, 0, 1);                             /* its metatable */
+  lua_getfield(L, LUA_REGISTRYINDEX, HTTPD_LUA_BASE_ENV);
+  lua_setfield(L, -2, "__index");
+  lua_setmetatable(L, -2);
+
+  lua_pushvalue(L, -1);
+  lua_setfield(L, -2, "_G");
+
+  lua_createtable(L, 0, 1);
+  lua_setfield(L, -2, HTTP_PARAMS_TABLE);
+
+  lua_replace(L, LUA_GLOBALSINDEX);
+}
+
+/*---------------------------------------------------------------------------*/
+lua_State *
+httpd_lua_acquire(void)
+{
+  int i, free_slot = -1;
+
+  for (i = 0; i < HTTPD_LUA_POOL_SIZE; i++) {
+    if (pool[i].users > 0)
+      continue;
+    if (pool[i].L != NULL) {
+      pool[i].users = 1;
+      stats.hits++;
+      return pool[i].L;
+    }
+    if (free_slot < 0)
+      free_slot = i;
+  }
+
+  if (free_slot < 0)
+    return NULL;
+
+  stats.misses++;
+  if ((pool[free_slot].L = httpd_lua_new()) != NULL)
+    pool[free_slot].users = 1;
+  return pool[free_slot].L;
+}
+
+/*---------------------------------------------------------------------------*/
+/* One more user of L, which goes back to the pool after its last
+   httpd_lua_release() */
+void
+httpd_lua_hold(lua_State *L)
+{
+  int i;
+
+  for (i = 0; i < HTTPD_LUA_POOL_SIZE; i++) {
+    if (pool[i].L == L) {
+      pool[i].users++;
+      return;
+    }
+  }
+}
+
+/*---------------------------------------------------------------------------*/
+void
+httpd_lua_release(lua_State *L)
+{
+  int i;
+
+  for (i = 0; i < HTTPD_LUA_POOL_SIZE; i++) {
+    if (pool[i].L == L) {
+      if (pool[i].users > 0 && --pool[i].users == 0) {
+        httpd_lua_reset(L);
+        lua_gc(L, LUA_GCCOLLECT, 0);
+      }
+      return;
+    }
+  }
+}
+
+/*---------------------------------------------------------------------------*/
+const struct httpd_lua_pool_stats *
+httpd_lua_pool_stats(void)
+{
+  return &stats;
+}
+
+/*---------------------------------------------------------------------------*/
+const struct httpd_lua_abort_stats *
+httpd_lua_abort_stats(void)
+{
+  return &abort_stats;
+}
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef __HTTPD_LUA_H__
+#define __HTTPD_LUA_H__
+
+#include <lua.h>
+#include "platform_conf.h"
+
+struct httpd_state;
+
+/* Number of interpreters kept ready for the web pages */
+#ifndef HTTPD_LUA_POOL_SIZE
+#define HTTPD_LUA_POOL_SIZE WEB_MAX_CLIENT
+#endif
+
+/* A handler gives the CPU back to the main loop after this number of
+   instructions of the virtual machine */
+#ifndef HTTPD_LUA_SLICE
+#define HTTPD_LUA_SLICE 10000
+#endif
+
+/* tmr.delay() in a handler yields for delays of this many microseconds
+   or more (rounded up to a poll), shorter ones wait in place */
+#ifndef HTTPD_LUA_DELAY_YIELD
+#define HTTPD_LUA_DELAY_YIELD 10000
+#endif
+
+/* What the scripts of a request may use before they are aborted:
+   instructions, and milliseconds running (sleeps do not count, and a
+   sleep starts a new budget) */
+#ifndef HTTPD_LUA_BUDGET
+#define HTTPD_LUA_BUDGET 5000000UL
+#endif
+#ifndef HTTPD_LUA_TIME_MAX
+#define HTTPD_LUA_TIME_MAX 5000
+#endif
+
+/* httpd_state.overrun */
+#define HTTPD_LUA_OVER_COUNT  1
+#define HTTPD_LUA_OVER_TIME   2
+
+/* Registry key of the globals table holding the libraries */
+#define HTTPD_LUA_BASE_ENV "httpd_base_env"
+
+struct httpd_lua_pool_stats {
+  unsigned long hits;    /* an initialised interpreter was reused */
+  unsigned long misses;  /* lua_open() + luaL_openlibs() had to run */
+};
+
+struct httpd_lua_abort_stats {
+  unsigned long count;   /* a request ran HTTPD_LUA_BUDGET instructions */
+  unsigned long time;    /* a request ran HTTPD_LUA_TIME_MAX ms */
+};
+
+void       httpd_lua_pool_init(void);
+lua_State *httpd_lua_new(void);
+lua_State *httpd_lua_acquire(void);
+void       httpd_lua_hold(lua_State *L);
+void       httpd_lua_release(lua_State *L);
+void       httpd_lua_reset(lua_State *L);
+void       httpd_lua_bind(lua_State *L, struct httpd_state *s);
+lua_State *httpd_lua_main(lua_State *L);
+struct httpd_state *httpd_lua_conn(lua_State *L);
+const struct httpd_lua_pool_stats *httpd_lua_pool_stats(void);
+const struct httpd_lua_abort_stats *httpd_lua_abort_stats(void);
+
+#endif /* __HTTPD_LUA_H__ */
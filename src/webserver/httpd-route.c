@@ -0,0 +1,321 @@
+/*
+ * Routes of the web server: paths answered by a C function or by a Lua
+ * function of a state that stays open, without any file behind them.
+ *
+ * The patterns are kept in a compressed prefix tree (a node holds the
+ * part of a pattern its siblings do not share), so a lookup reads every
+ * character of the path at most once. The nodes come from a fixed pool
+ * and the labels point in a copy of the pattern that created them; the
+ * nodes left without a route below them go back to the pool when a route
+ * is removed.
+ */
+#include "platform_conf.h"
+#ifdef BUILD_WEB_SERVER
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <lua.h>
+#include <lauxlib.h>
+#include "type.h"
+#include "httpd.h"
+#include "httpd-lua.h"
+#include "httpd-strings.h"
+#include "httpd-route.h"
+
+#define ROUTE_NODES (2 * HTTPD_ROUTE_MAX + 1)
+
+struct route_node {
+  const char *label;
+  unsigned char len;
+  char own;              /* label is the copy, freed with the node */
+  signed char child;     /* first child, -1 for none */
+  signed char next;      /* next sibling */
+  signed char route;     /* index in routes, -1 if no pattern ends here */
+};
+
+static struct route_node nodes[ROUTE_NODES];
+static unsigned char nnodes;
+static struct httpd_route routes[HTTPD_ROUTE_MAX];
+
+/*---------------------------------------------------------------------------*/
+static int
+route_node_new(const char *label, unsigned char len)
+{
+  struct route_node *n;
+  int i;
+
+  /* a node given back by route_prune() first */
+  for(i = 0; i < nnodes && nodes[i].label != NULL; i++)
+    ;
+  if(i == nnodes) {
+    if(nnodes >= ROUTE_NODES)
+      return -1;
+    nnodes++;
+  }
+  n = &nodes[i];
+  n->label = label;
+  n->len = len;
+  n->own = FALSE;
+  n->child = n->next = n->route = -1;
+  return i;
+}
+
+/*---------------------------------------------------------------------------*/
+/* Give back the nodes below node that lead to no route. A label copy is
+   only pointed in by the nodes below its own, which go first. */
+static void
+route_prune(int node)
+{
+  signed char *link = &nodes[node].child;
+  int c;
+
+  while((c = *link) >= 0) {
+    route_prune(c);
+    if(nodes[c].route < 0 && nodes[c].child < 0) {
+      *link = nodes[c].next;
+      if(nodes[c].own)
+        free((char *)nodes[c].label);
+      nodes[c].label = NULL;
+    } else {
+      link = &nodes[c].next;
+    }
+  }
+}
+
+/*---------------------------------------------------------------------------*/
+static int
+route_child(int node, char c)
+{
+  int i;
+
+  for(i = nodes[node].child; i >= 0 && nodes[i].label[0] != c; i = nodes[i].next)
+    ;
+  return i;
+}
+
+/*---------------------------------------------------------------------------*/
+/* Node of pattern, created if needed. Returns -1 when there is no room */
+static int
+route_insert(const char *pattern)
+{
+  const char *p = pattern;
+  char *copy;
+  int node = 0, c, m;
+  size_t len;
+  unsigned char common;
+
+  while(*p != 0) {
+    if((c = route_child(node, *p)) < 0) {
+      /* a new branch holds the rest of the pattern */
+      len = strlen(p);
+      if(len > 255 || (copy = malloc(len + 1)) == NULL)
+        return -1;
+      if((c = route_node_new(copy, len)) < 0) {
+        free(copy);
+        return -1;
+      }
+      strcpy(copy, p);
+      nodes[c].own = TRUE;
+      nodes[c].next = nodes[node].child;
+      nodes[node].child = c;
+      return c;
+    }
+    for(common = 0; common < nodes[c].len && nodes[c].label[common] == p[common]; common++)
+      ;
+    if(common < nodes[c].len) {
+      /* the pattern ends or leaves inside c: its end becomes a child */
+      if((m = route_node_new(nodes[c].label + common, nodes[c].len - common)) < 0)
+        return -1;
+      nodes[m].child = nodes[c].child;
+      nodes[m].route = nodes[c].route;
+      nodes[c].child = m;
+      nodes[c].len = common;
+      nodes[c].route = -1;
+    }
+    node = c;
+    p += common;
+  }
+  return node;
+}
+
+/*---------------------------------------------------------------------------*/
+/* Node of the route for path: the same pattern, else the longest one
+   ending with '/' that starts path (unless exact is set). -1 if none */
+static int
+route_lookup(const char *path, int exact)
+{
+  const char *p = path;
+  int node = 0, c, best = -1;
+
+  if(nnodes == 0)
+    return -1;
+  while(1) {
+    if(nodes[node].route >= 0) {
+      if(*p == 0)
+        return node;
+      if(!exact && p > path && p[-1] == '/')
+        best = node;
+    }
+    if(*p == 0 || (c = route_child(node, *p)) < 0 ||
+       strncmp(p, nodes[c].label, nodes[c].len) != 0)
+      break;
+    p += nodes[c].len;
+    node = c;
+  }
+  return best;
+}
+
+/*---------------------------------------------------------------------------*/
+static void
+route_clear(struct httpd_route *r)
+{
+  if(r->L != NULL) {
+    luaL_unref(r->L, LUA_REGISTRYINDEX, r->ref);
+    httpd_lua_release(r->L);
+  }
+  free(r->pattern);
+  free(r->type);
+  memset(r, 0, sizeof(*r));
+}
+
+/*---------------------------------------------------------------------------*/
+/* The entry of pattern, emptied, or NULL */
+static struct httpd_route *
+route_get(const char *pattern, const char *mime)
+{
+  struct httpd_route *r;
+  int node, i;
+
+  if(pattern[0] != '/')
+    return NULL;
+  if(nnodes == 0)
+    route_node_new("", 0);
+
+  if((node = route_lookup(pattern, TRUE)) < 0) {
+    for(i = 0; i < HTTPD_ROUTE_MAX && (routes[i].fn != NULL || routes[i].L != NULL); i++)
+      ;
+    if(i == HTTPD_ROUTE_MAX || (node = route_insert(pattern)) < 0) {
+      fprintf(stderr, "httpd_route: no room for %s\n", pattern);
+      return NULL;
+    }
+    nodes[node].route = i;
+  }
+  r = &routes[(int)nodes[node].route];
+  route_clear(r);
+
+  if((r->pattern = malloc(strlen(pattern) + 1)) != NULL)
+    strcpy(r->pattern, pattern);
+  if(mime != NULL && (r->type = malloc(strlen(mime) + 19)) != NULL)
+    sprintf(r->type, "Content-type: %s\r\n\r\n", mime);
+  r->stream = mime != NULL && strcmp(mime, http_text_event_stream) == 0;
+  return r;
+}
+
+/*---------------------------------------------------------------------------*/
+/* Answer pattern with fn; mime is the content type, NULL for text/html */
+int
+httpd_route_add(const char *pattern, httpd_route_fn fn, const char *mime)
+{
+  struct httpd_route *r;
+
+  if((r = route_get(pattern, mime)) == NULL)
+    return 0;
+  r->fn = fn;
+  return 1;
+}
+
+/*---------------------------------------------------------------------------*/
+/* Answer pattern with the function at idx of L, called with the table of
+   the parameters and the path. A nil value removes the route. A route of
+   C is left alone: a stream can be calling it. */
+int
+httpd_route_add_lua(lua_State *L, const char *pattern, int idx, const char *mime)
+{
+  struct httpd_route *r;
+  int node;
+
+  node = route_lookup(pattern, TRUE);
+  if(node >= 0 && routes[(int)nodes[node].route].fn != NULL)
+    return 0;
+  if(lua_isnil(L, idx)) {
+    if(node >= 0) {
+      route_clear(&routes[(int)nodes[node].route]);
+      nodes[node].route = -1;
+      route_prune(0);
+    }
+    return 1;
+  }
+
+  if((r = route_get(pattern, mime)) == NULL)
+    return 0;
+  lua_pushvalue(L, idx);
+  r->ref = luaL_ref(L, LUA_REGISTRYINDEX);
+  /* L can be the coroutine of a page: keep the state itself, out of the
+     pool while the route lives */
+  r->L = httpd_lua_main(L);
+  httpd_lua_hold(r->L);
+  return 1;
+}
+
+/*---------------------------------------------------------------------------*/
+/* The route of pattern, added before, takes websocket connections */
+int
+httpd_route_websocket(const char *pattern)
+{
+  int node = route_lookup(pattern, TRUE);
+
+  if(node < 0)
+    return 0;
+  routes[(int)nodes[node].route].ws = TRUE;
+  return 1;
+}
+
+/*---------------------------------------------------------------------------*/
+struct httpd_route *
+httpd_route_find(const char *path)
+{
+  int node = route_lookup(path, FALSE);
+
+  return node < 0 ? NULL : &routes[(int)nodes[node].route];
+}
+
+/*---------------------------------------------------------------------------*/
+/* Route i, NULL if it is free */
+struct httpd_route *
+httpd_route_get(int i)
+{
+  if(i < 0 || i >= HTTPD_ROUTE_MAX || (routes[i].fn == NULL && routes[i].L == NULL))
+    return NULL;
+  return &routes[i];
+}
+
+/*---------------------------------------------------------------------------*/
+/* The statistics, then the route script if there is one, in a state that
+   is never closed */
+void
+httpd_route_init(void)
+{
+  lua_State *L;
+  FILE *fp;
+  const char *boot = HTTPD_ROUTE_BOOT_ROM;
+
+  if((L = httpd_lua_new()) == NULL)
+    return;
+  if(luaL_loadstring(L, "print(json.stringify(httpd.stats()))") == 0)
+    httpd_route_add_lua(L, HTTPD_STATS_PATH, -1, http_application_json);
+  lua_settop(L, 0);
+
+  if((fp = fopen(boot, "r")) == NULL) {
+    boot = HTTPD_ROUTE_BOOT_MMC;
+    if((fp = fopen(boot, "r")) == NULL)
+      return;
+  }
+  fclose(fp);
+
+  if(luaL_dofile(L, boot) != 0)
+    fprintf(stderr, "%s\n", lua_tostring(L, -1));
+  lua_settop(L, 0);
+}
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef __HTTPD_ROUTE_H__
+#define __HTTPD_ROUTE_H__
+
+#include <lua.h>
+#include "httpd-fs.h"
+#include "httpd-stats.h"
+
+struct httpd_state;
+
+/* Number of routes */
+#ifndef HTTPD_ROUTE_MAX
+#define HTTPD_ROUTE_MAX 8
+#endif
+
+/* Lua script run at start in a state of its own, to set the routes of
+   the server; the romfs is searched first, then the files of httpd_fs */
+#define HTTPD_ROUTE_BOOT_ROM "/rom/routes.lua"
+#define HTTPD_ROUTE_BOOT_MMC FILE_NAME_PREFIX "/routes.lua"
+
+/* A C handler writes its answer with http_buffer_str(), which holds
+   WRITE_BUFFER_SIZE bytes; the parameters are in s->url.
+   With the type text/event-stream the connection stays open: the handler
+   is called again at every poll, it sends events with http_sse_send()
+   and can keep its place in s->cursor. It must not wait for a producer
+   (a sample taken in an interrupt is kept there until the next poll).
+   A websocket handler is called for each message of the client, which is
+   in s->ws; what it writes is sent back as one message. */
+typedef void (*httpd_route_fn)(struct httpd_state *s);
+
+struct httpd_route {
+  char *pattern;
+  httpd_route_fn fn;     /* C handler, or NULL */
+  lua_State *L;          /* state of a Lua handler */
+  int ref;               /* the function, in the registry of L */
+  char *type;            /* Content-type line, NULL for text/html */
+  char stream;           /* text/event-stream */
+  char ws;               /* websocket: called for each message */
+  struct httpd_hist hist;  /* durations of the responses */
+};
+
+/* A pattern matches the same path; one ending with '/' matches all the
+   paths below it too, the longest such pattern wins.
+   A Lua route added by a page holds the state of the page, which is not
+   given to another connection until the route is removed or replaced. */
+void                httpd_route_init(void);
+int                 httpd_route_add(const char *pattern, httpd_route_fn fn, const char *mime);
+int                 httpd_route_add_lua(lua_State *L, const char *pattern, int idx, const char *mime);
+int                 httpd_route_websocket(const char *pattern);
+struct httpd_route *httpd_route_find(const char *path);
+struct httpd_route *httpd_route_get(int i);
+
+#endif /* __HTTPD_ROUTE_H__ */
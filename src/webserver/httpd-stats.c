@@ -0,0 +1,58 @@
+/*
+ * Counters of the web server, and histograms of the durations of the
+ * requests in powers of two milliseconds: per phase, per route and per
+ * kind of file. The clock is the system tick of the platform, in
+ * microseconds.
+ */
+#include "platform_conf.h"
+#ifdef BUILD_WEB_SERVER
+
+#include <string.h>
+#include "type.h"
+#include "platform.h"
+#include "httpd-stats.h"
+
+const char * const httpd_stats_phases[HTTPD_PHASES] = {
+  "parse", "open", "load", "exec", "send"
+};
+
+static struct httpd_stats stats;
+
+/*---------------------------------------------------------------------------*/
+void
+httpd_stats_init(void)
+{
+  memset(&stats, 0, sizeof(stats));
+}
+
+/*---------------------------------------------------------------------------*/
+/* Microseconds, modulo 2^32: only differences make sense */
+u32
+httpd_stats_clock(void)
+{
+  return platform_eth_get_clock_us();
+}
+
+/*---------------------------------------------------------------------------*/
+void
+httpd_stats_hist(struct httpd_hist *h, u32 us)
+{
+  u32 ms = us / 1000;
+  int i;
+
+  for(i = 0; ms > 0 && i < HTTPD_STATS_BUCKETS - 1; i++)
+    ms >>= 1;
+  h->b[i]++;
+  h->n++;
+  if(us > h->max_us)
+    h->max_us = us;
+}
+
+/*---------------------------------------------------------------------------*/
+struct httpd_stats *
+httpd_stats(void)
+{
+  return &stats;
+}
+
+#endif
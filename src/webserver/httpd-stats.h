@@ -0,0 +1,50 @@
+#ifndef __HTTPD_STATS_H__
+#define __HTTPD_STATS_H__
+
+#include "type.h"
+
+/* Path of a built-in route answering the statistics in JSON */
+#ifndef HTTPD_STATS_PATH
+#define HTTPD_STATS_PATH "/_stats"
+#endif
+
+/* Histograms: bucket 0 counts the durations under 1 ms, bucket i those
+   under 2^i ms, the last one all the longer ones */
+#define HTTPD_STATS_BUCKETS 12
+
+/* phases of a request */
+#define HTTPD_PHASE_PARSE  0  /* request line, headers and body */
+#define HTTPD_PHASE_OPEN   1  /* file system */
+#define HTTPD_PHASE_LOAD   2  /* splitting and compiling a page or script */
+#define HTTPD_PHASE_EXEC   3  /* Lua and C handlers */
+#define HTTPD_PHASE_SEND   4  /* the rest, mostly waiting for the client */
+#define HTTPD_PHASES       5
+
+struct httpd_hist {
+  unsigned long n;
+  unsigned long max_us;
+  unsigned long b[HTTPD_STATS_BUCKETS];
+};
+
+struct httpd_stats {
+  unsigned long requests;
+  unsigned long status[5];      /* responses 1xx to 5xx */
+  unsigned long bytes;          /* sent, without the retransmissions */
+  unsigned long timeouts;       /* connections aborted after 20 silent polls */
+  unsigned long idle;           /* persistent connections closed idle */
+  unsigned long resets;         /* clients gone before the end of a response */
+  unsigned short write_hwm;     /* most of a write buffer used */
+  unsigned short heap_hwm;      /* most KB used by a Lua state of a page */
+  struct httpd_hist phase[HTTPD_PHASES];
+  struct httpd_hist pages;      /* .pht and .lua, the whole response */
+  struct httpd_hist files;      /* the other files */
+};
+
+extern const char * const httpd_stats_phases[HTTPD_PHASES];
+
+void                httpd_stats_init(void);
+u32                 httpd_stats_clock(void);
+void                httpd_stats_hist(struct httpd_hist *h, u32 us);
+struct httpd_stats *httpd_stats(void);
+
+#endif /* __HTTPD_STATS_H__ */
@@ -3,6 +3,7 @@ extern const char http_200[5];
 extern const char http_301[5];
 extern const char http_302[5];
 extern const char http_get[5];
+extern const char http_post[6];
 extern const char http_10[9];
 extern const char http_11[9];
 extern const char http_content_type[15];
@@ -14,8 +15,44 @@ extern const char http_index_pht[10];
 extern const char http_index_html[12];
 extern const char http_404_html[10];
 extern const char http_referer[9];
-extern const char http_header_200[84];
-extern const char http_header_404[91];
+extern const char http_connection[12];
+extern const char http_connection_close[20];
+extern const char http_connection_keepalive[25];
+extern const char http_content_length[17];
+extern const char http_transfer_chunked[29];
+extern const char http_last_chunk[6];
+extern const char http_accept_encoding[17];
+extern const char http_accept[8];
+extern const char http_gzip[5];
+extern const char http_gz[4];
+extern const char http_content_encoding_gzip[25];
+extern const char http_vary_accept_encoding[24];
+extern const char http_header_200[65];
+extern const char http_header_404[72];
+extern const char http_if_none_match[15];
+extern const char http_if_modified_since[19];
+extern const char http_cache_control_nocache[26];
+extern const char http_header_304[75];
+extern const char http_range[7];
+extern const char http_if_range[10];
+extern const char http_bytes[7];
+extern const char http_accept_ranges[23];
+extern const char http_header_206[78];
+extern const char http_header_416[84];
+extern const char http_content_length_hdr[16];
+extern const char http_expect[8];
+extern const char http_100_continue[13];
+extern const char http_form_urlencoded[34];
+extern const char http_header_100[26];
+extern const char http_header_413[87];
+extern const char http_header_101[82];
+extern const char http_header_400[74];
+extern const char http_header_503[82];
+extern const char http_upgrade[9];
+extern const char http_websocket[10];
+extern const char http_sec_websocket_key[19];
+extern const char http_ws_upgrade[64];
+extern const char http_ws_guid[37];
 extern const char http_content_type_plain[29];
 extern const char http_content_type_html[28];
 extern const char http_content_type_css [27];
@@ -24,6 +61,18 @@ extern const char http_content_type_png [28];
 extern const char http_content_type_gif [28];
 extern const char http_content_type_jpg [29];
 extern const char http_content_type_binary[43];
+extern const char http_content_type_js[41];
+extern const char http_content_type_json[35];
+extern const char http_content_type_cbor[35];
+extern const char http_content_type_ico[31];
+extern const char http_content_type_svg[32];
+extern const char http_content_type_xml[27];
+extern const char http_text_event_stream[18];
+extern const char http_application_json[17];
+extern const char http_application_cbor[17];
+extern const char http_sse_event[8];
+extern const char http_sse_data[7];
+extern const char http_sse_keepalive[4];
 extern const char http_html[6];
 extern const char http_pht[5];
 extern const char http_lua[5];
@@ -34,3 +83,10 @@ extern const char http_gif[5];
 extern const char http_jpg[5];
 extern const char http_text[5];
 extern const char http_txt[5];
+extern const char http_js[4];
+extern const char http_json[6];
+extern const char http_cbor[6];
+extern const char http_ico[5];
+extern const char http_svg[5];
+extern const char http_xml[5];
+extern const char http_jpeg[6];
@@ -0,0 +1,254 @@
+/*
+ * Compiled page cache for the web server.
+ *
+ * A .pht page is loaded and split in static text and <?lua ... ?> blocks
+ * only the first time it is asked for (or when its size or modification
+ * time changes); a .lua script is kept the same way as a single block.
+ * Every Lua state compiles a block once and keeps the function in its
+ * registry, later requests only swap the environment and call it.
+ */
+#include "platform_conf.h"
+#ifdef BUILD_WEB_SERVER
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <lua.h>
+#include <lauxlib.h>
+#include "type.h"
+#include "httpd.h"
+#include "httpd-fs.h"
+#include "httpd-tpl.h"
+
+#define TPL_OPEN   "<?lua"
+#define TPL_CLOSE  "?>"
+
+#define STR_len(x) (sizeof(x)-1)
+
+static struct httpd_tpl cache[HTTPD_TPL_CACHE_NR];
+static unsigned long tpl_gen, tpl_tick;
+static struct httpd_tpl_stats stats;
+
+/*---------------------------------------------------------------------------*/
+static void
+tpl_free(struct httpd_tpl *t)
+{
+  free(t->text);
+  free(t->seg);
+  t->text = NULL;
+  t->seg = NULL;
+  t->nseg = 0;
+  t->name[0] = 0;
+  t->stale = FALSE;
+}
+
+/*---------------------------------------------------------------------------*/
+/* Walk the page, count the segments when seg is NULL or fill seg. */
+static unsigned short
+tpl_split(const char *text, size_t len, struct httpd_tpl_seg *seg)
+{
+  const char *p = text, *open, *close;
+  unsigned short n = 0;
+
+  while(p < text + len) {
+    open = strstr(p, TPL_OPEN);
+    close = open ? strstr(open + STR_len(TPL_OPEN), TPL_CLOSE) : NULL;
+    if(close == NULL) {
+      /* no more (complete) blocks, the rest is sent as it is */
+      open = close = text + len;
+    }
+    if(open > p) {
+      if(seg) {
+        seg[n].off = p - text;
+        seg[n].len = open - p;
+        seg[n].code = FALSE;
+      }
+      n++;
+    }
+    if(close == text + len)
+      break;
+    if(seg) {
+      seg[n].off = open + STR_len(TPL_OPEN) - text;
+      seg[n].len = close - (open + STR_len(TPL_OPEN));
+      seg[n].code = TRUE;
+    }
+    n++;
+    p = close + STR_len(TPL_CLOSE);
+  }
+  return n;
+}
+
+/*---------------------------------------------------------------------------*/
+static int
+tpl_load(struct httpd_tpl *t, const char *name, struct httpd_fs_file *file, int mode)
+{
+  if(!httpd_fs_load(file))
+    return 0;
+
+  strncpy(t->name, name, sizeof(t->name) - 1);
+  t->name[sizeof(t->name) - 1] = 0;
+  t->mtime = file->mtime;
+  t->size = file->len;
+  t->gen = ++tpl_gen;
+  t->stale = FALSE;
+
+  /* the cache entry takes the buffer over */
+  t->text = file->mem;
+  file->mem = NULL;
+  httpd_fs_close(file);
+
+  if(mode == HTTPD_TPL_SCRIPT)
+    t->nseg = 1;
+  else
+    t->nseg = tpl_split(t->text, t->size, NULL);
+
+  if(t->nseg > 0 && (t->seg = malloc(t->nseg * sizeof(struct httpd_tpl_seg))) == NULL) {
+    fprintf(stderr, "httpd_tpl_get(): malloc error\n");
+    tpl_free(t);
+    return 0;
+  }
+
+  if(mode == HTTPD_TPL_SCRIPT) {
+    t->seg[0].off = 0;
+    t->seg[0].len = t->size;
+    t->seg[0].code = TRUE;
+  } else {
+    tpl_split(t->text, t->size, t->seg);
+  }
+  return 1;
+}
+
+/*---------------------------------------------------------------------------*/
+/* Return the split page for the file opened in file, loading it if needed.
+   The file is closed in any case, the entry must be given back with
+   httpd_tpl_put(). */
+struct httpd_tpl *
+httpd_tpl_get(const char *name, struct httpd_fs_file *file, int mode)
+{
+  struct httpd_tpl *t, *victim = NULL;
+  int i;
+
+  for(i = 0; i < HTTPD_TPL_CACHE_NR; i++) {
+    t = &cache[i];
+    if(t->text == NULL || t->stale || strncmp(t->name, name, sizeof(t->name)) != 0)
+      continue;
+    if(t->mtime == file->mtime && t->size == file->len) {
+      httpd_fs_close(file);
+      stats.hits++;
+      t->users++;
+      t->used = ++tpl_tick;
+      return t;
+    }
+    /* the file has changed */
+    if(t->users == 0)
+      tpl_free(t);
+    else
+      t->stale = TRUE;
+  }
+
+  for(i = 0; i < HTTPD_TPL_CACHE_NR; i++) {
+    t = &cache[i];
+    if(t->text == NULL && !t->stale) {
+      victim = t;
+      break;
+    }
+    if(t->users == 0 && (victim == NULL || t->used < victim->used))
+      victim = t;
+  }
+
+  if(victim == NULL) {
+    fprintf(stderr, "httpd_tpl_get(): no free entry for %s\n", name);
+    httpd_fs_close(file);
+    return NULL;
+  }
+
+  tpl_free(victim);
+  stats.misses++;
+  if(!tpl_load(victim, name, file, mode)) {
+    httpd_fs_close(file);
+    return NULL;
+  }
+  victim->users = 1;
+  victim->used = ++tpl_tick;
+  return victim;
+}
+
+/*---------------------------------------------------------------------------*/
+void
+httpd_tpl_put(struct httpd_tpl *t)
+{
+  if(t == NULL || t->users == 0)
+    return;
+  if(--t->users == 0 && t->stale)
+    tpl_free(t);
+}
+
+/*---------------------------------------------------------------------------*/
+/* Push the function of a Lua block of t, running with the current
+   globals of L. Returns 0, or an error with the message pushed. */
+int
+httpd_tpl_push(lua_State *L, struct httpd_tpl *t, unsigned short seg)
+{
+  int error;
+
+  /* registry[HTTPD_TPL_CHUNKS][t] = { [0] = gen, [seg + 1] = function } */
+  lua_getfield(L, LUA_REGISTRYINDEX, HTTPD_TPL_CHUNKS);
+  if(!lua_istable(L, -1)) {
+    lua_pop(L, 1);
+    lua_newtable(L);
+    lua_pushvalue(L, -1);
+    lua_setfield(L, LUA_REGISTRYINDEX, HTTPD_TPL_CHUNKS);
+  }
+
+  lua_pushlightuserdata(L, t);
+  lua_rawget(L, -2);
+  if(lua_istable(L, -1)) {
+    lua_rawgeti(L, -1, 0);
+    if((unsigned long)lua_tonumber(L, -1) != t->gen) {
+      lua_pop(L, 2);
+      lua_pushnil(L);
+    } else {
+      lua_pop(L, 1);
+    }
+  }
+  if(!lua_istable(L, -1)) {
+    /* first run in this state, or the entry holds another page now */
+    lua_pop(L, 1);
+    lua_createtable(L, t->nseg, 1);
+    lua_pushnumber(L, t->gen);
+    lua_rawseti(L, -2, 0);
+    lua_pushlightuserdata(L, t);
+    lua_pushvalue(L, -2);
+    lua_rawset(L, -4);
+  }
+
+  lua_rawgeti(L, -1, seg + 1);
+  if(!lua_isfunction(L, -1)) {
+    lua_pop(L, 1);
+    error = luaL_loadbuffer(L, t->text + t->seg[seg].off, t->seg[seg].len, t->name);
+    if(error) {
+      lua_replace(L, -3);
+      lua_pop(L, 1);
+      return error;
+    }
+    lua_pushvalue(L, -1);
+    lua_rawseti(L, -3, seg + 1);
+  }
+
+  /* the page globals are replaced at every new page */
+  lua_pushvalue(L, LUA_GLOBALSINDEX);
+  lua_setfenv(L, -2);
+
+  lua_replace(L, -3);
+  lua_pop(L, 1);
+  return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+const struct httpd_tpl_stats *
+httpd_tpl_stats(void)
+{
+  return &stats;
+}
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef __HTTPD_TPL_H__
+#define __HTTPD_TPL_H__
+
+#include <time.h>
+#include <lua.h>
+#include "platform_conf.h"
+#include "uipopt.h"
+#include "httpd-fs.h"
+
+/* Number of pages kept split and ready to run, every uIP connection holds
+   at most one of them so a free entry is always there */
+#ifndef HTTPD_TPL_CACHE_NR
+#define HTTPD_TPL_CACHE_NR (UIP_CONNS + 2)
+#endif
+
+/* Registry key of the table holding the compiled chunks of a state */
+#define HTTPD_TPL_CHUNKS "httpd_tpl_chunks"
+
+/* httpd_tpl_get() modes */
+#define HTTPD_TPL_PAGE   0  /* .pht: html with <?lua ... ?> blocks */
+#define HTTPD_TPL_SCRIPT 1  /* .lua: the whole file is a chunk */
+
+struct httpd_tpl_seg {
+  unsigned short off;   /* offset in text (files are <= FILE_LOAD_MAX_SIZE) */
+  unsigned short len;
+  char code;            /* TRUE for a Lua block, FALSE for static text */
+};
+
+struct httpd_tpl {
+  char name[HTTPD_FS_NAME_LEN]; /* same size as httpd_state.filename */
+  time_t mtime;                 /* the entry is valid while name, mtime */
+  size_t size;                  /* and size match the file */
+  unsigned long gen;            /* unique id of this compilation */
+  unsigned long used;           /* last use, for the LRU replacement */
+  char *text;                   /* whole file, zero terminated */
+  struct httpd_tpl_seg *seg;
+  unsigned short nseg;
+  unsigned char users;          /* connections sending this page */
+  char stale;                   /* file changed while in use */
+};
+
+struct httpd_tpl_stats {
+  unsigned long hits;      /* page found already split */
+  unsigned long misses;    /* page loaded and split */
+};
+
+struct httpd_tpl *httpd_tpl_get(const char *name, struct httpd_fs_file *file, int mode);
+void              httpd_tpl_put(struct httpd_tpl *t);
+int               httpd_tpl_push(lua_State *L, struct httpd_tpl *t, unsigned short seg);
+const struct httpd_tpl_stats *httpd_tpl_stats(void);
+
+#endif /* __HTTPD_TPL_H__ */
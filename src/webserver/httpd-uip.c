@@ -10,6 +10,8 @@
 #include "uip-split.h"
 #include "dhcpc.h"
 #include "resolv.h"
+#include "httpd.h"
+#include "httpd-cache.h"
 #include <string.h>
 
 // *****************************************************************************
@@ -22,25 +24,29 @@ static u32 periodic_timer, arp_timer;
 #define BUF                     ((struct uip_eth_hdr *)&uip_buf[0])
 
 // UIP Timers (in ms)
-#define UIP_PERIODIC_TIMER_MS   500
+#define UIP_PERIODIC_TIMER_MS   HTTPD_POLL_MS
 #define UIP_ARP_TIMER_MS        10000
 
 #define IP_TCP_HEADER_LENGTH 40
 #define TOTAL_HEADER_LENGTH (IP_TCP_HEADER_LENGTH+UIP_LLH_LEN)
 
-// This gets called on both Ethernet RX interrupts and timer requests,
-// but it's called only from the Ethernet interrupt handler
+// One turn of the main loop: the frames the Ethernet interrupt flagged,
+// the timers of the open connections when the tick says so, and the
+// scripts that gave the CPU back. With nothing left to do the CPU sleeps
+// until the next interrupt.
 void httpd_uip_mainloop()
 {
   u32 temp, packet_len;
+  int busy = 0;
 
   // Increment uIP timers
   temp = platform_eth_get_elapsed_time();
   periodic_timer += temp;
   arp_timer += temp;
+  httpd_cache_tick( temp );
 
-  // Check for an RX packet and read it
-  if( ( packet_len = platform_eth_get_packet_nb( uip_buf, sizeof( uip_buf ) ) ) > 0 )
+  // Read the RX packets, none if no interrupt came since the last one
+  while( ( packet_len = platform_eth_get_packet_nb( uip_buf, sizeof( uip_buf ) ) ) > 0 )
   {
     // Set uip_len for uIP stack usage.
     uip_len = ( unsigned short )packet_len;
@@ -73,11 +79,15 @@ void httpd_uip_mainloop()
     	platform_eth_send_packet( uip_buf, uip_len, TRUE);
     }
   }
-  else if( periodic_timer >= UIP_PERIODIC_TIMER_MS )
+
+  if( periodic_timer >= UIP_PERIODIC_TIMER_MS )
   {
     periodic_timer = 0;
     for( temp = 0; temp < UIP_CONNS; temp ++ )
     {
+      // A free slot has no timer
+      if( uip_conns[ temp ].tcpstateflags == UIP_CLOSED )
+        continue;
       uip_periodic( temp );
 
       // If the above function invocation resulted in data that
@@ -93,6 +103,8 @@ void httpd_uip_mainloop()
 #if UIP_UDP
     for( temp = 0; temp < UIP_UDP_CONNS; temp ++ )
     {
+      if( uip_udp_conns[ temp ].lport == 0 )
+        continue;
       uip_udp_periodic( temp );
 
       // If the above function invocation resulted in data that
@@ -113,6 +125,23 @@ void httpd_uip_mainloop()
       uip_arp_timer();
     }
   }
+
+  // Let the scripts that gave the CPU back go on
+  for( temp = 0; temp < UIP_CONNS; temp ++ )
+  {
+    if( httpd_resume( &uip_conns[ temp ] ) && uip_len > 0 )
+    {
+      uip_arp_out();
+      platform_eth_send_packet( uip_buf, uip_len, TRUE);
+    }
+    // A slice that gave the CPU back again goes on at the next turn
+    if( uip_conns[ temp ].tcpstateflags != UIP_CLOSED &&
+        ( ( struct httpd_state * )&uip_conns[ temp ].appstate )->runnable )
+      busy = 1;
+  }
+
+  if( !busy )
+    platform_eth_idle();
 }
 
 // *****************************************************************************
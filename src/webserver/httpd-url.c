@@ -0,0 +1,335 @@
+/*
+ * Request target and form decoding for the web server.
+ *
+ * The target is decoded a byte at a time as the segments come, so that
+ * neither the path nor the query string have to fit in a line buffer.
+ * The same decoder takes the body of an application/x-www-form-urlencoded
+ * POST. The parameters wait in a heap block until the page runs, they are
+ * then set in a table of the Lua state. Any other body is kept as it came,
+ * for the scripts to read or parse.
+ */
+#include "platform_conf.h"
+#ifdef BUILD_WEB_SERVER
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <lua.h>
+#include "type.h"
+#include "httpd-url.h"
+
+/* the parameters block grows by this much */
+#define URL_GROW 64
+
+/*---------------------------------------------------------------------------*/
+static int
+url_room(struct httpd_url *u, unsigned short n)
+{
+  char *p;
+  unsigned short size;
+
+  if(u->overflow)
+    return 0;
+  if(u->paramlen + n <= u->paramsize)
+    return 1;
+
+  size = u->paramsize + URL_GROW;
+  if(size > HTTPD_URL_PARAMS_MAX || (p = realloc(u->params, size)) == NULL) {
+    fprintf(stderr, "httpd_url: parameters too big\n");
+    u->overflow = TRUE;
+    return 0;
+  }
+  u->params = p;
+  u->paramsize = size;
+  return 1;
+}
+
+/*---------------------------------------------------------------------------*/
+/* a name or a value starts with room for its length */
+static void
+url_tok_begin(struct httpd_url *u)
+{
+  u->tok = u->paramlen;
+  if(url_room(u, 2))
+    u->paramlen += 2;
+}
+
+static void
+url_tok_end(struct httpd_url *u)
+{
+  unsigned short len;
+
+  if(u->overflow)
+    return;
+  len = u->paramlen - u->tok - 2;
+  u->params[u->tok] = len & 0xff;
+  u->params[u->tok + 1] = len >> 8;
+}
+
+/*---------------------------------------------------------------------------*/
+static void
+url_pair_end(struct httpd_url *u)
+{
+  if(u->overflow)
+    return;
+  if(u->state == HTTPD_URL_KEY) {
+    if(u->paramlen == u->tok + 2) {
+      /* nothing between two '&' */
+      u->paramlen = u->tok;
+      return;
+    }
+    /* a name alone gets an empty value */
+    url_tok_end(u);
+    url_tok_begin(u);
+  }
+  url_tok_end(u);
+}
+
+/*---------------------------------------------------------------------------*/
+static void
+url_path_end(struct httpd_url *u)
+{
+  if(u->pathlen < u->pathsize)
+    u->path[u->pathlen] = 0;
+}
+
+/*---------------------------------------------------------------------------*/
+static void
+url_put(struct httpd_url *u, char c)
+{
+  if(u->state == HTTPD_URL_PATH) {
+    if(u->pathlen < u->pathsize)
+      u->path[u->pathlen] = c;
+    if(u->pathlen < 0xffff)
+      u->pathlen++;
+  } else if(u->state == HTTPD_URL_KEY || u->state == HTTPD_URL_VALUE) {
+    if(url_room(u, 1))
+      u->params[u->paramlen++] = c;
+  }
+}
+
+/*---------------------------------------------------------------------------*/
+static int
+url_hex(char c)
+{
+  return isdigit((unsigned char)c) ? c - '0' : tolower((unsigned char)c) - 'a' + 10;
+}
+
+/*---------------------------------------------------------------------------*/
+static void
+url_char(struct httpd_url *u, char c)
+{
+  /* %xx escapes; a broken one is kept as it came */
+  if(u->pct == 1) {
+    u->pct = 0;
+    if(isxdigit((unsigned char)c)) {
+      u->pctc = c;
+      u->pct = 2;
+      return;
+    }
+    url_put(u, '%');
+  } else if(u->pct == 2) {
+    u->pct = 0;
+    if(isxdigit((unsigned char)c)) {
+      url_put(u, (url_hex(u->pctc) << 4) | url_hex(c));
+      return;
+    }
+    url_put(u, '%');
+    url_put(u, u->pctc);
+  }
+
+  switch(c) {
+  case '%':
+    u->pct = 1;
+    return;
+  case '?':
+    if(u->state == HTTPD_URL_PATH) {
+      url_path_end(u);
+      u->state = HTTPD_URL_KEY;
+      url_tok_begin(u);
+      return;
+    }
+    break;
+  case '=':
+    if(u->state == HTTPD_URL_KEY) {
+      url_tok_end(u);
+      url_tok_begin(u);
+      u->state = HTTPD_URL_VALUE;
+      return;
+    }
+    break;
+  case '&':
+    if(u->state == HTTPD_URL_KEY || u->state == HTTPD_URL_VALUE) {
+      url_pair_end(u);
+      u->state = HTTPD_URL_KEY;
+      url_tok_begin(u);
+      return;
+    }
+    break;
+  case '+':
+    if(u->state != HTTPD_URL_PATH)
+      c = ' ';
+    break;
+  }
+  url_put(u, c);
+}
+
+/*---------------------------------------------------------------------------*/
+/* Forget the previous request, the path will be decoded in path */
+void
+httpd_url_init(struct httpd_url *u, char *path, unsigned short pathsize)
+{
+  httpd_url_free(u);
+  u->path = path;
+  u->pathsize = pathsize;
+  u->pathlen = 0;
+  u->path[0] = 0;
+  u->state = HTTPD_URL_DONE;
+  u->pct = 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/* Begin a target (HTTPD_URL_PATH), a form (HTTPD_URL_KEY) or data to be
+   thrown away (HTTPD_URL_SKIP) */
+void
+httpd_url_start(struct httpd_url *u, char state)
+{
+  u->state = state;
+  u->pct = 0;
+  if(state == HTTPD_URL_KEY)
+    url_tok_begin(u);
+}
+
+/*---------------------------------------------------------------------------*/
+/* Begin a body of len bytes that is kept as it comes, or thrown away if
+   it is bigger than HTTPD_URL_BODY_MAX */
+void
+httpd_url_body(struct httpd_url *u, long len)
+{
+  httpd_url_body_free(u);
+  u->state = HTTPD_URL_SKIP;
+  if(len > HTTPD_URL_BODY_MAX || (u->body = malloc(len + 1)) == NULL) {
+    fprintf(stderr, "httpd_url: body too big\n");
+    return;
+  }
+  u->bodysize = len;
+  u->state = HTTPD_URL_BODY;
+}
+
+/*---------------------------------------------------------------------------*/
+/* Decode len bytes of data, up to the stop character if it is not -1.
+   Returns the number of bytes used, the stop character included; the
+   state is HTTPD_URL_DONE once it has been found. */
+unsigned short
+httpd_url_feed(struct httpd_url *u, const char *data, unsigned short len, int stop)
+{
+  unsigned short i;
+
+  if(u->state == HTTPD_URL_BODY) {
+    i = len < u->bodysize - u->bodylen ? len : u->bodysize - u->bodylen;
+    memcpy(u->body + u->bodylen, data, i);
+    u->bodylen += i;
+    return len;
+  }
+  for(i = 0; i < len; i++) {
+    if((unsigned char)data[i] == stop) {
+      httpd_url_end(u);
+      return i + 1;
+    }
+    url_char(u, data[i]);
+  }
+  return len;
+}
+
+/*---------------------------------------------------------------------------*/
+void
+httpd_url_end(struct httpd_url *u)
+{
+  if(u->pct > 0) {
+    url_put(u, '%');
+    if(u->pct == 2)
+      url_put(u, u->pctc);
+    u->pct = 0;
+  }
+  if(u->state == HTTPD_URL_BODY)
+    u->body[u->bodylen] = 0;
+  else if(u->state == HTTPD_URL_PATH)
+    url_path_end(u);
+  else if(u->state == HTTPD_URL_KEY || u->state == HTTPD_URL_VALUE)
+    url_pair_end(u);
+  u->state = HTTPD_URL_DONE;
+}
+
+/*---------------------------------------------------------------------------*/
+static void
+url_params_free(struct httpd_url *u)
+{
+  free(u->params);
+  u->params = NULL;
+  u->paramlen = 0;
+  u->paramsize = 0;
+  u->overflow = FALSE;
+}
+
+/*---------------------------------------------------------------------------*/
+void
+httpd_url_body_free(struct httpd_url *u)
+{
+  free(u->body);
+  u->body = NULL;
+  u->bodylen = 0;
+  u->bodysize = 0;
+}
+
+/*---------------------------------------------------------------------------*/
+void
+httpd_url_free(struct httpd_url *u)
+{
+  url_params_free(u);
+  httpd_url_body_free(u);
+}
+
+/*---------------------------------------------------------------------------*/
+/* Value of the parameter name (not zero terminated), NULL if missing */
+const char *
+httpd_url_param(struct httpd_url *u, const char *name, unsigned short *len)
+{
+  unsigned short p = 0, klen, vlen;
+  const char *value = NULL;
+
+  while(!u->overflow && p + 4 <= u->paramlen) {
+    klen = (unsigned char)u->params[p] | ((unsigned char)u->params[p + 1] << 8);
+    vlen = (unsigned char)u->params[p + 2 + klen] | ((unsigned char)u->params[p + 3 + klen] << 8);
+    if(klen == strlen(name) && memcmp(u->params + p + 2, name, klen) == 0) {
+      /* the last one wins, as in the table */
+      value = u->params + p + 4 + klen;
+      *len = vlen;
+    }
+    p += 4 + klen + vlen;
+  }
+  return value;
+}
+
+/*---------------------------------------------------------------------------*/
+/* Push a table with the parameters decoded, their block is freed unless
+   keep; the body stays for the scripts */
+void
+httpd_url_push(lua_State *L, struct httpd_url *u, int keep)
+{
+  unsigned short p = 0, klen, vlen;
+
+  lua_newtable(L);
+  while(!u->overflow && p + 4 <= u->paramlen) {
+    klen = (unsigned char)u->params[p] | ((unsigned char)u->params[p + 1] << 8);
+    vlen = (unsigned char)u->params[p + 2 + klen] | ((unsigned char)u->params[p + 3 + klen] << 8);
+    lua_pushlstring(L, u->params + p + 2, klen);
+    lua_pushlstring(L, u->params + p + 4 + klen, vlen);
+    lua_rawset(L, -3);
+    p += 4 + klen + vlen;
+  }
+  if(!keep)
+    url_params_free(u);
+}
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef __HTTPD_URL_H__
+#define __HTTPD_URL_H__
+
+#include <lua.h>
+
+/* Largest size of the decoded parameters of a request (query string and
+   form body together) */
+#ifndef HTTPD_URL_PARAMS_MAX
+#define HTTPD_URL_PARAMS_MAX 2048
+#endif
+
+/* Largest body of another type kept for the scripts (httpd.body(),
+   httpd.json()) */
+#ifndef HTTPD_URL_BODY_MAX
+#define HTTPD_URL_BODY_MAX 2048
+#endif
+
+/* httpd_url.state */
+#define HTTPD_URL_PATH   0  /* path of the target, up to '?' */
+#define HTTPD_URL_KEY    1  /* name of a parameter, up to '=' or '&' */
+#define HTTPD_URL_VALUE  2  /* value of a parameter, up to '&' */
+#define HTTPD_URL_SKIP   3  /* data thrown away (body of another type) */
+#define HTTPD_URL_DONE   4  /* stop character of the target seen */
+#define HTTPD_URL_BODY   5  /* body of another type, kept as it comes */
+
+/* Decoder of a request target or of an application/x-www-form-urlencoded
+   body. The data can come in any number of pieces, the path is decoded
+   in a buffer of the caller, the parameters in a heap block. A body of
+   another type can be kept as it is in a block of its own. */
+struct httpd_url {
+  char state;
+  char pct;                 /* digits of a %xx escape seen so far */
+  char pctc;                /* the first one */
+  char overflow;            /* parameters lost: too big or no memory */
+  char *path;
+  unsigned short pathsize;
+  unsigned short pathlen;   /* can be >= pathsize: the path is too long */
+  char *params;             /* name, value, ... each a 2 byte length + bytes */
+  unsigned short paramlen;
+  unsigned short paramsize;
+  unsigned short tok;       /* offset of the name or value being decoded */
+  char *body;               /* the body kept, '\0' terminated, or NULL */
+  unsigned short bodylen;
+  unsigned short bodysize;
+};
+
+void           httpd_url_init(struct httpd_url *u, char *path, unsigned short pathsize);
+void           httpd_url_start(struct httpd_url *u, char state);
+void           httpd_url_body(struct httpd_url *u, long len);
+void           httpd_url_body_free(struct httpd_url *u);
+unsigned short httpd_url_feed(struct httpd_url *u, const char *data, unsigned short len, int stop);
+void           httpd_url_end(struct httpd_url *u);
+void           httpd_url_free(struct httpd_url *u);
+const char    *httpd_url_param(struct httpd_url *u, const char *name, unsigned short *len);
+void           httpd_url_push(lua_State *L, struct httpd_url *u, int keep);
+
+#endif /* __HTTPD_URL_H__ */
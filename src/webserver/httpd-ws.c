@@ -0,0 +1,341 @@
+/*
+ * Websockets (RFC 6455) for the web server.
+ *
+ * The handshake needs the SHA-1 of the key of the client, encoded in
+ * base64. The frames of the client are decoded a byte at a time as the
+ * segments come, unmasked in a heap block for a data message and in a
+ * small buffer for a control frame, which can come between two fragments
+ * of a message. The server sends frames without a mask.
+ */
+#include "platform_conf.h"
+#ifdef BUILD_WEB_SERVER
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "type.h"
+#include "httpd-strings.h"
+#include "httpd-ws.h"
+
+/* httpd_ws.hstate */
+#define WS_HDR0  0  /* fin and opcode */
+#define WS_HDR1  1  /* mask bit and length */
+#define WS_LEN   2  /* extended length, count bytes to go */
+#define WS_MASK  3  /* masking key, count bytes to go */
+#define WS_DATA  4  /* payload, left bytes to go */
+
+#define WS_KEY_MAX 32
+
+/*---------------------------------------------------------------------------*/
+static unsigned long
+ws_rol(unsigned long x, int n)
+{
+  return ((x << n) | ((x & 0xffffffffUL) >> (32 - n))) & 0xffffffffUL;
+}
+
+/*---------------------------------------------------------------------------*/
+/* one block of SHA-1; the schedule is kept in 16 words */
+static void
+ws_sha1_block(unsigned long *h, const unsigned char *p)
+{
+  unsigned long w[16], a, b, c, d, e, f, k, t;
+  int i;
+
+  for(i = 0; i < 16; i++) {
+    w[i] = ((unsigned long)p[4 * i] << 24) | ((unsigned long)p[4 * i + 1] << 16) |
+           ((unsigned long)p[4 * i + 2] << 8) | p[4 * i + 3];
+  }
+  a = h[0]; b = h[1]; c = h[2]; d = h[3]; e = h[4];
+  for(i = 0; i < 80; i++) {
+    if(i >= 16) {
+      w[i & 15] = ws_rol(w[(i + 13) & 15] ^ w[(i + 8) & 15] ^ w[(i + 2) & 15] ^ w[i & 15], 1);
+    }
+    if(i < 20) {
+      f = (b & c) | (~b & d);
+      k = 0x5a827999UL;
+    } else if(i < 40) {
+      f = b ^ c ^ d;
+      k = 0x6ed9eba1UL;
+    } else if(i < 60) {
+      f = (b & c) | (b & d) | (c & d);
+      k = 0x8f1bbcdcUL;
+    } else {
+      f = b ^ c ^ d;
+      k = 0xca62c1d6UL;
+    }
+    t = (ws_rol(a, 5) + (f & 0xffffffffUL) + e + k + w[i & 15]) & 0xffffffffUL;
+    e = d;
+    d = c;
+    c = ws_rol(b, 30);
+    b = a;
+    a = t;
+  }
+  h[0] = (h[0] + a) & 0xffffffffUL;
+  h[1] = (h[1] + b) & 0xffffffffUL;
+  h[2] = (h[2] + c) & 0xffffffffUL;
+  h[3] = (h[3] + d) & 0xffffffffUL;
+  h[4] = (h[4] + e) & 0xffffffffUL;
+}
+
+/*---------------------------------------------------------------------------*/
+static void
+ws_sha1(const unsigned char *data, unsigned short len, unsigned char *out)
+{
+  unsigned long h[5] = { 0x67452301UL, 0xefcdab89UL, 0x98badcfeUL, 0x10325476UL, 0xc3d2e1f0UL };
+  unsigned char last[128];
+  unsigned short n, i;
+  unsigned long bits = (unsigned long)len * 8;
+
+  for(; len >= 64; data += 64, len -= 64) {
+    ws_sha1_block(h, data);
+  }
+  /* the rest, the 0x80 byte and the length in bits, in one or two blocks */
+  memset(last, 0, sizeof(last));
+  memcpy(last, data, len);
+  last[len] = 0x80;
+  n = len < 56 ? 64 : 128;
+  for(i = 0; i < 4; i++) {
+    last[n - 1 - i] = (bits >> (8 * i)) & 0xff;
+  }
+  ws_sha1_block(h, last);
+  if(n == 128) {
+    ws_sha1_block(h, last + 64);
+  }
+  for(i = 0; i < 20; i++) {
+    out[i] = (h[i / 4] >> (24 - 8 * (i % 4))) & 0xff;
+  }
+}
+
+/*---------------------------------------------------------------------------*/
+static void
+ws_base64(const unsigned char *in, unsigned short len, char *out)
+{
+  static const char digits[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  unsigned long v;
+  unsigned short i;
+
+  for(i = 0; i < len; i += 3) {
+    v = (unsigned long)in[i] << 16;
+    if(i + 1 < len)
+      v |= in[i + 1] << 8;
+    if(i + 2 < len)
+      v |= in[i + 2];
+    *out++ = digits[(v >> 18) & 0x3f];
+    *out++ = digits[(v >> 12) & 0x3f];
+    *out++ = i + 1 < len ? digits[(v >> 6) & 0x3f] : '=';
+    *out++ = i + 2 < len ? digits[v & 0x3f] : '=';
+  }
+  *out = 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/* A websocket for the Sec-WebSocket-Key value key, NULL if no memory */
+struct httpd_ws *
+httpd_ws_new(const char *key)
+{
+  struct httpd_ws *ws;
+  unsigned char buf[WS_KEY_MAX + sizeof(http_ws_guid)];
+  unsigned char digest[20];
+  unsigned short len;
+
+  if((ws = calloc(1, sizeof(*ws))) == NULL)
+    return NULL;
+
+  while(*key == ' ')
+    key++;
+  for(len = 0; len < WS_KEY_MAX && key[len] > ' '; len++)
+    buf[len] = key[len];
+  memcpy(buf + len, http_ws_guid, sizeof(http_ws_guid) - 1);
+  ws_sha1(buf, len + sizeof(http_ws_guid) - 1, digest);
+  ws_base64(digest, sizeof(digest), ws->accept);
+  return ws;
+}
+
+/*---------------------------------------------------------------------------*/
+void
+httpd_ws_free(struct httpd_ws **ws)
+{
+  if(*ws != NULL) {
+    free((*ws)->msg);
+    free(*ws);
+    *ws = NULL;
+  }
+}
+
+/*---------------------------------------------------------------------------*/
+/* Answer with a close frame of status, nothing else is read */
+void
+httpd_ws_close(struct httpd_ws *ws, unsigned short status)
+{
+  ws->ctlop = HTTPD_WS_CLOSE;
+  ws->ctl[0] = status >> 8;
+  ws->ctl[1] = status & 0xff;
+  ws->ctllen = 2;
+  ws->ready = HTTPD_WS_CLOSE;
+}
+
+/*---------------------------------------------------------------------------*/
+/* the header has been read: check the frame, make room for its payload */
+static void
+ws_frame_begin(struct httpd_ws *ws)
+{
+  unsigned char opcode = ws->hbyte & 0x0f;
+  char *p;
+
+  if(opcode >= HTTPD_WS_CLOSE) {
+    if(!(ws->hbyte & 0x80) || ws->left > sizeof(ws->ctl)) {
+      httpd_ws_close(ws, HTTPD_WS_PROTOCOL);
+      return;
+    }
+    ws->ctlop = opcode;
+    ws->ctllen = 0;
+  } else if(opcode == HTTPD_WS_CONT) {
+    if(ws->opcode == 0) {
+      httpd_ws_close(ws, HTTPD_WS_PROTOCOL);
+      return;
+    }
+  } else {
+    if(ws->opcode != 0 || (opcode != HTTPD_WS_TEXT && opcode != HTTPD_WS_BINARY)) {
+      httpd_ws_close(ws, HTTPD_WS_PROTOCOL);
+      return;
+    }
+    ws->opcode = opcode;
+    ws->msglen = 0;
+    ws->discard = FALSE;
+  }
+
+  if(opcode < HTTPD_WS_CLOSE && !ws->discard) {
+    if(ws->msglen + ws->left > HTTPD_WS_MSG_MAX) {
+      ws->discard = TRUE;
+    } else if(ws->msglen + ws->left > ws->msgsize) {
+      if((p = realloc(ws->msg, ws->msglen + ws->left)) == NULL) {
+        ws->discard = TRUE;
+      } else {
+        ws->msg = p;
+        ws->msgsize = ws->msglen + ws->left;
+      }
+    }
+  }
+  ws->pos = 0;
+  ws->hstate = WS_DATA;
+}
+
+/*---------------------------------------------------------------------------*/
+static void
+ws_frame_end(struct httpd_ws *ws)
+{
+  ws->hstate = WS_HDR0;
+  if((ws->hbyte & 0x0f) >= HTTPD_WS_CLOSE) {
+    if(ws->ctlop == HTTPD_WS_CLOSE) {
+      /* the status is sent back, without the reason */
+      if(ws->ctllen > 2)
+        ws->ctllen = 2;
+      ws->ready = HTTPD_WS_CLOSE;
+    } else if(ws->ctlop == HTTPD_WS_PING) {
+      ws->ready = HTTPD_WS_PING;
+    }
+    return;
+  }
+  if(ws->hbyte & 0x80) {
+    if(ws->discard)
+      httpd_ws_close(ws, HTTPD_WS_TOO_BIG);
+    else
+      ws->ready = ws->opcode;
+    ws->opcode = 0;
+  }
+}
+
+/*---------------------------------------------------------------------------*/
+/* Decode len bytes of the client. Returns the number of bytes used: it
+   stops after a message, a ping or a close, with ready set to its opcode,
+   until httpd_ws_done() is called. */
+unsigned short
+httpd_ws_feed(struct httpd_ws *ws, const char *data, unsigned short len)
+{
+  unsigned short i;
+  unsigned char c;
+
+  for(i = 0; i < len && ws->ready == 0; i++) {
+    c = data[i];
+    switch(ws->hstate) {
+    case WS_HDR0:
+      ws->hbyte = c;
+      ws->hstate = WS_HDR1;
+      break;
+    case WS_HDR1:
+      if(!(c & 0x80)) {
+        /* the frames of a client are masked */
+        httpd_ws_close(ws, HTTPD_WS_PROTOCOL);
+        break;
+      }
+      ws->left = c & 0x7f;
+      if(ws->left >= 126) {
+        ws->count = ws->left == 126 ? 2 : 8;
+        ws->left = 0;
+        ws->hstate = WS_LEN;
+      } else {
+        ws->count = 4;
+        ws->hstate = WS_MASK;
+      }
+      break;
+    case WS_LEN:
+      /* a length above 16 MB stays there, it is too big anyway */
+      ws->left = ws->left > 0xffffffUL ? 0xffffffffUL : (ws->left << 8) | c;
+      if(--ws->count == 0) {
+        ws->count = 4;
+        ws->hstate = WS_MASK;
+      }
+      break;
+    case WS_MASK:
+      ws->mask[4 - ws->count] = c;
+      if(--ws->count == 0) {
+        ws_frame_begin(ws);
+        if(ws->ready == 0 && ws->left == 0)
+          ws_frame_end(ws);
+      }
+      break;
+    case WS_DATA:
+      c ^= ws->mask[ws->pos++ & 3];
+      if((ws->hbyte & 0x0f) >= HTTPD_WS_CLOSE)
+        ws->ctl[ws->ctllen++] = c;
+      else if(!ws->discard)
+        ws->msg[ws->msglen++] = c;
+      if(--ws->left == 0)
+        ws_frame_end(ws);
+      break;
+    }
+  }
+  return i;
+}
+
+/*---------------------------------------------------------------------------*/
+/* What was ready has been answered: the decoding goes on */
+void
+httpd_ws_done(struct httpd_ws *ws)
+{
+  if(ws->ready == HTTPD_WS_TEXT || ws->ready == HTTPD_WS_BINARY) {
+    free(ws->msg);
+    ws->msg = NULL;
+    ws->msglen = ws->msgsize = 0;
+  }
+  ws->ready = 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/* Write in out the header of a frame of the server. Returns its size. */
+unsigned short
+httpd_ws_header(char *out, int opcode, int fin, unsigned short len)
+{
+  out[0] = (fin ? 0x80 : 0) | opcode;
+  if(len < 126) {
+    out[1] = len;
+    return 2;
+  }
+  out[1] = 126;
+  out[2] = len >> 8;
+  out[3] = len & 0xff;
+  return 4;
+}
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef __HTTPD_WS_H__
+#define __HTTPD_WS_H__
+
+/* Largest message taken from a client, the fragments put together */
+#ifndef HTTPD_WS_MSG_MAX
+#define HTTPD_WS_MSG_MAX 1024
+#endif
+
+/* Largest header of a frame sent: the payload is never above 64 KB */
+#define HTTPD_WS_HEADER_MAX 4
+
+/* opcodes */
+#define HTTPD_WS_CONT    0x0
+#define HTTPD_WS_TEXT    0x1
+#define HTTPD_WS_BINARY  0x2
+#define HTTPD_WS_CLOSE   0x8
+#define HTTPD_WS_PING    0x9
+#define HTTPD_WS_PONG    0xa
+
+/* status of a close frame */
+#define HTTPD_WS_NORMAL    1000
+#define HTTPD_WS_PROTOCOL  1002
+#define HTTPD_WS_TOO_BIG   1009
+
+/* A websocket connection (RFC 6455): the decoder of the frames of the
+   client, which can come in any number of pieces, and what is sent back */
+struct httpd_ws {
+  char accept[29];          /* Sec-WebSocket-Accept of the handshake */
+  char open;                /* the handshake has been sent */
+  char closing;             /* a close frame has been sent */
+  char ping;                /* the client has been silent, a ping is due */
+  char ready;               /* opcode of what was received, 0 until then */
+  char fin;                 /* the output being sent ends the reply */
+  char cont;                /* part of the reply has been sent */
+  /* frame being decoded */
+  char hstate;
+  unsigned char hbyte;      /* its first byte: fin and opcode */
+  unsigned char opcode;     /* of the message being put together */
+  unsigned char count;      /* bytes of the length or the mask read */
+  unsigned char mask[4];
+  unsigned long left;       /* payload bytes still to come */
+  unsigned char pos;        /* in the mask */
+  /* data message */
+  char *msg;
+  unsigned short msglen;
+  unsigned short msgsize;
+  char discard;             /* the message was too big */
+  /* control frame */
+  unsigned char ctlop;
+  unsigned char ctllen;
+  char ctl[125];
+};
+
+struct httpd_ws *httpd_ws_new(const char *key);
+void             httpd_ws_free(struct httpd_ws **ws);
+unsigned short   httpd_ws_feed(struct httpd_ws *ws, const char *data, unsigned short len);
+void             httpd_ws_done(struct httpd_ws *ws);
+void             httpd_ws_close(struct httpd_ws *ws, unsigned short status);
+unsigned short   httpd_ws_header(char *out, int opcode, int fin, unsigned short len);
+
+#endif /* __HTTPD_WS_H__ */
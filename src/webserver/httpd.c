@@ -58,7 +58,10 @@
 #ifdef BUILD_WEB_SERVER
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
+#include <time.h>
 #include <lua.h>
 #include <lauxlib.h>
 #include <lualib.h>
@@ -67,36 +70,60 @@
 #include "platform.h"
 #include "httpd-fs.h"
 #include "httpd-strings.h"
+#include "httpd-lua.h"
+#include "httpd-tpl.h"
+#include "httpd-url.h"
+#include "httpd-route.h"
+#include "httpd-stats.h"
+#include "httpd-cache.h"
+#include "luajson_lib.h"
 
 #define STATE_WAITING 0
 #define STATE_OUTPUT  1
 
+/* the quotes, the dash and the terminator around two longs in hex */
+#define HTTP_ETAG_LEN (2 * 2 * sizeof(long) + 4)
+
 #define ISO_nl           0x0a
+#define ISO_cr           0x0d
 #define ISO_space        0x20
 #define ISO_bang         0x21
 #define ISO_percent      0x25
 #define ISO_period       0x2e
 #define ISO_slash        0x2f
 #define ISO_colon        0x3a
-#define ISO_minor        '<'
 #define ISO_question     '?'
-#define CGI_close        "?>"
-
-#define STR_len(x)       (sizeof(x)-1)
 
-static int       http_run_elua (struct httpd_state *, char *, int);
+static int       http_run_elua (struct httpd_state *, unsigned short);
+static int       http_resume_elua (struct httpd_state *);
+static void      http_run_route (struct httpd_state *, struct httpd_route *);
+static void      http_end_elua (struct httpd_state *);
+static void      http_stream_body (struct httpd_state *);
+static void      http_budget (struct httpd_state *);
+static void      http_stats_begin (struct httpd_state *);
+static void      http_stats_end (struct httpd_state *);
+static void      http_phase (struct httpd_state *, int);
 static void      set_httpd_state_struct(struct httpd_state *);
 static           PT_THREAD(http_output_elua (struct httpd_state *));
+static           PT_THREAD(http_output_first (struct httpd_state *));
+static           PT_THREAD(http_output_stream (struct httpd_state *));
+static           PT_THREAD(http_ws_output (struct httpd_state *));
 
 
+/* the interpreter of each client: its pages share their globals */
 static struct {
 	  lua_State *L;
 	  u16_t ripaddr[2];
 } connection[WEB_MAX_CLIENT];
 
 
+/* the connection whose C or Lua handler is running, for the writes that
+   do not come from a bound thread (stdout); NULL between two calls */
 static struct httpd_state *g_httpd_state;
 
+/* httpd_resume() is polling: not a tick of the timers */
+static char resuming;
+
 struct httpd_state *get_httpd_state_struct()
 {
   return g_httpd_state;
@@ -107,6 +134,52 @@ void set_httpd_state_struct(struct httpd_state *s)
   g_httpd_state = s;
 }
 
+/*---------------------------------------------------------------------------*/
+/* The interpreter of the client of s, a clean one for a new page. A new
+   client takes a free slot, else the next one in turn; a state dropped
+   goes back to the pool once the scripts still running in it end. */
+static lua_State *
+http_session(struct httpd_state *s, int new_page)
+{
+  static int next;
+  int i;
+
+  for(i = 0; i < WEB_MAX_CLIENT && !uip_ipaddr_cmp(s->ripaddr, connection[i].ripaddr); i++)
+    ;
+  if(i == WEB_MAX_CLIENT) {
+    for(i = 0; i < WEB_MAX_CLIENT && connection[i].L != NULL; i++)
+      ;
+    if(i == WEB_MAX_CLIENT) {
+      i = next;
+      next = (next + 1) % WEB_MAX_CLIENT;
+    }
+    uip_ipaddr_copy(connection[i].ripaddr, s->ripaddr);
+    new_page = TRUE;
+  }
+  s->http_connection_nr = i;
+
+  if(new_page && connection[i].L != NULL) {
+    httpd_lua_release(connection[i].L);
+    connection[i].L = NULL;
+  }
+  if(connection[i].L == NULL) {
+    connection[i].L = httpd_lua_acquire();
+    fprintf(stderr,"remote ip: %d.%d.%d.%d [%d]\n", uip_ipaddr1(s->ripaddr), uip_ipaddr2(s->ripaddr),
+                                             uip_ipaddr3(s->ripaddr), uip_ipaddr4(s->ripaddr),s->http_connection_nr);
+  } else {
+    fprintf(stderr,"         : %d.%d.%d.%d [%d]\n", uip_ipaddr1(s->ripaddr), uip_ipaddr2(s->ripaddr),
+    			                               uip_ipaddr3(s->ripaddr), uip_ipaddr4(s->ripaddr),s->http_connection_nr);
+  }
+  return connection[i].L;
+}
+/*---------------------------------------------------------------------------*/
+void httpd_init(void)
+{
+  httpd_stats_init();
+  httpd_lua_pool_init();
+  httpd_route_init();
+}
+
 _ssize_t http_uart_send_str(const char *ptr, _ssize_t len)
 {
   _ssize_t i;
@@ -119,6 +192,155 @@ _ssize_t http_uart_send_str(const char *ptr, _ssize_t len)
   return i;
 }
 /*---------------------------------------------------------------------------*/
+/* give back what the response was using */
+static void
+http_release(struct httpd_state *s)
+{
+  httpd_fs_close(&s->file);
+  httpd_tpl_put(s->tpl);
+  s->tpl = NULL;
+  http_end_elua(s);
+  httpd_url_free(&s->url);
+  httpd_ws_free(&s->ws);
+  httpd_cache_put(s->cached);
+  s->cached = NULL;
+  if(s->L != NULL) {
+    httpd_lua_release(s->L);
+    s->L = NULL;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+http_etag(struct httpd_state *s, char *buf)
+{
+  /* buf holds HTTP_ETAG_LEN bytes */
+  sprintf(buf, "\"%lx-%lx\"", (unsigned long)s->mtime, (unsigned long)s->size);
+}
+/*---------------------------------------------------------------------------*/
+/* the date of the file, in the format of HTTP */
+static size_t
+http_date(struct httpd_state *s, char *buf, size_t len)
+{
+  struct tm tm;
+
+  return strftime(buf, len, "%a, %d %b %Y %H:%M:%S GMT", gmtime_r(&s->mtime, &tm));
+}
+/*---------------------------------------------------------------------------*/
+/* Validators of the file about to be sent. Returns TRUE when the copy
+   of the client is still good. */
+static int
+http_validators(struct httpd_state *s)
+{
+  char etag[HTTP_ETAG_LEN], date[30];
+  int fresh = FALSE;
+
+  s->mtime = s->file.mtime;
+  s->size = s->file.len;
+  if(s->mtime == 0) {
+    /* the date of the file is not known, it is asked again each time */
+    if(s->if_range) {
+      s->range = FALSE;
+    }
+    return FALSE;
+  }
+  http_etag(s, etag);
+  http_date(s, date, sizeof(date));
+  if(s->cond_type == HTTPD_COND_ETAG) {
+    fresh = (strstr(s->cond, etag) != NULL || strcmp(s->cond, "*") == 0);
+  } else if(s->cond_type == HTTPD_COND_DATE) {
+    /* clients send back the date they were given */
+    fresh = (strcmp(s->cond, date) == 0);
+  }
+  if(s->if_range && !(s->cond_type == HTTPD_COND_RANGE &&
+                      (strcmp(s->cond, etag) == 0 || strcmp(s->cond, date) == 0))) {
+    /* the part the client has is from another version: whole file */
+    s->range = FALSE;
+  }
+  return fresh;
+}
+/*---------------------------------------------------------------------------*/
+/* keep the value of a conditional request header */
+static void
+http_set_cond(struct httpd_state *s, char type, const char *value)
+{
+  size_t len;
+
+  while(*value == ISO_space) {
+    value++;
+  }
+  strncpy(s->cond, value, sizeof(s->cond) - 1);
+  s->cond[sizeof(s->cond) - 1] = 0;
+  len = strlen(s->cond);
+  if(len > 0 && s->cond[len - 1] == ISO_cr) {
+    s->cond[len - 1] = 0;
+  }
+  s->cond_type = type;
+}
+/*---------------------------------------------------------------------------*/
+/* keep a "Range: bytes=first-last" request, other forms and lists of
+   ranges get the whole file */
+static void
+http_set_range(struct httpd_state *s, const char *value)
+{
+  char *end;
+
+  s->range = FALSE;
+  while(*value == ISO_space) {
+    value++;
+  }
+  if(strncmp(value, http_bytes, 6) != 0 || strchr(value, ',') != NULL) {
+    return;
+  }
+  value += 6;
+  s->range_first = -1;
+  if(*value != '-') {
+    s->range_first = strtol(value, &end, 10);
+    if(end == value || *end != '-') {
+      return;
+    }
+    value = end;
+  }
+  value++;
+  s->range_last = -1;
+  if(isdigit((unsigned char)*value)) {
+    s->range_last = strtol(value, NULL, 10);
+  } else if(s->range_first < 0) {
+    return;
+  }
+  if(s->range_first >= 0 && s->range_last >= 0 && s->range_last < s->range_first) {
+    return;
+  }
+  s->range = TRUE;
+}
+/*---------------------------------------------------------------------------*/
+/* restrict s->file to the range asked, returns the status to send */
+static const char *
+http_apply_range(struct httpd_state *s)
+{
+  long size = s->size, first = s->range_first, last = s->range_last;
+
+  if(!s->range) {
+    return http_header_200;
+  }
+  if(first < 0) {
+    /* the last bytes of the file */
+    first = last < size ? size - last : 0;
+    last = size - 1;
+  } else if(last < 0 || last >= size) {
+    last = size - 1;
+  }
+  if(first >= size || first > last) {
+    s->file.len = 0;
+    return http_header_416;
+  }
+  s->range_first = first;
+  s->range_last = last;
+  /* httpd_fs_read() seeks to pos */
+  s->file.pos = first;
+  s->file.len = last - first + 1;
+  return http_header_206;
+}
+/*---------------------------------------------------------------------------*/
 static unsigned short
 generate_part_of_file(void *state)
 {
@@ -129,7 +351,7 @@ generate_part_of_file(void *state)
   } else {
     s->len = s->file.len;
   }
-  memcpy(uip_appdata, s->file.data, s->len);
+  s->len = httpd_fs_read(&s->file, uip_appdata, s->len);
   
   return s->len;
 }
@@ -139,217 +361,711 @@ PT_THREAD(send_file(struct httpd_state *s))
 {
   PSOCK_BEGIN(&s->sout);
   
-  do {
+  while(s->file.len > 0) {
     PSOCK_GENERATOR_SEND(&s->sout, generate_part_of_file, s);
+    if(s->len == 0) {
+      /* read error, the file is shorter than announced */
+      break;
+    }
     s->file.len -= s->len;
-    s->file.data += s->len;
-  } while(s->file.len > 0);
+    s->file.pos += s->len;
+    httpd_stats()->bytes += s->len;
+  }
       
   PSOCK_END(&s->sout);
 }
 /*---------------------------------------------------------------------------*/
+/* copy the next piece of scriptptr in the uIP buffer, as a chunk if the
+   response is chunked */
+static unsigned short
+generate_part_of_body(void *state)
+{
+  struct httpd_state *s = (struct httpd_state *)state;
+  char *ptr = (char *)uip_appdata;
+  int max = uip_mss();
+
+  if(s->ws != NULL) {
+    max -= HTTPD_WS_HEADER_MAX;
+  } else if(s->chunked) {
+    max -= 8;  /* "ffff\r\n" + "\r\n" */
+  }
+  s->len = s->scriptlen > max ? max : s->scriptlen;
+
+  if(s->ws != NULL) {
+    /* a frame of the reply, the last one ends it */
+    ptr += httpd_ws_header(ptr, s->ws->cont ? HTTPD_WS_CONT : HTTPD_WS_TEXT,
+                           s->ws->fin && s->len == s->scriptlen, s->len);
+  } else if(s->chunked) {
+    ptr += sprintf(ptr, "%x\r\n", s->len);
+  }
+  memcpy(ptr, s->scriptptr, s->len);
+  ptr += s->len;
+  if(s->chunked) {
+    *ptr++ = ISO_cr;
+    *ptr++ = ISO_nl;
+  }
+  return ptr - (char *)uip_appdata;
+}
+/*---------------------------------------------------------------------------*/
 static
-PT_THREAD(send_part_of_file(struct httpd_state *s))
+PT_THREAD(send_body(struct httpd_state *s))
 {
   PSOCK_BEGIN(&s->sout);
-  PSOCK_SEND(&s->sout, s->file.data, s->len);
+
+  while(s->scriptlen > 0) {
+    PSOCK_GENERATOR_SEND(&s->sout, generate_part_of_body, s);
+    if(s->ws != NULL) {
+      s->ws->cont = !(s->ws->fin && s->len == s->scriptlen);
+    }
+    s->scriptptr += s->len;
+    s->scriptlen -= s->len;
+    httpd_stats()->bytes += s->len;
+  }
+
   PSOCK_END(&s->sout);
 }
 /*---------------------------------------------------------------------------*/
 static
-PT_THREAD(handle_elua_scripts(struct httpd_state *s))
+PT_THREAD(send_last_chunk(struct httpd_state *s))
 {
-  PT_BEGIN(&s->scriptpt);
-
-  http_run_elua(s,s->file.data, s->file.len);
-
-  PT_WAIT_THREAD(&s->scriptpt, http_output_elua(s));
-  PT_END(&s->scriptpt);
+  PSOCK_BEGIN(&s->sout);
+  PSOCK_SEND_STR(&s->sout, http_last_chunk);
+  PSOCK_END(&s->sout);
 }
-
 /*---------------------------------------------------------------------------*/
 static
 PT_THREAD(handle_elua_tags(struct httpd_state *s))
 {
-  char *ptr, *p;
-  
   PT_BEGIN(&s->scriptpt);
 
-  while(s->file.len > 0) {
-
-    /* Check if we should start executing a script. */
-    if(*s->file.data == ISO_minor && *(s->file.data + 1) == ISO_question && *(s->file.data + 2) == 'l'
-    	&& *(s->file.data + 3) == 'u' && *(s->file.data + 4) == 'a')
-    {
-      s->scriptptr = s->file.data + 6;
-      s->scriptlen = s->file.len - 6;
-
-   	  p = strstr(s->scriptptr, CGI_close);
-
-   	  if (p != NULL)
-   	  {
-   		p += STR_len(CGI_close);
-
-   		http_run_elua(s, s->scriptptr, (p - (s->scriptptr + STR_len(CGI_close))));
-
-   	    s->scriptlen -= (p - (s->scriptptr));
-   	    s->scriptptr = p;
-     	  /* The script is over, so we reset the pointers and continue
-  	     sending the rest of the file. */
-        s->file.data = s->scriptptr;
-        s->file.len = s->scriptlen;
-   	    PT_WAIT_THREAD(&s->scriptpt, http_output_elua(s)); /* this will do a return */
-   	  } else
-   	  {
-   	    /* The script is over, so we reset the pointers and continue
-	       sending the rest of the file. */
-        s->file.data = s->scriptptr;
-        s->file.len = s->scriptlen;
-   	  }
-    }
-    else
-    {
-      /* See if we find the start of script marker in the block of HTML	 to be sent. */
-      if(s->file.len > uip_mss())
- 	    s->len = uip_mss();
-      else
- 	    s->len = s->file.len;
-
-      if(*s->file.data == ISO_minor)
- 	    ptr = strchr(s->file.data + 1, ISO_minor);
-      else
- 	    ptr = strchr(s->file.data, ISO_minor);
-
-      if(ptr != NULL && ptr != s->file.data)
-      {
-	    s->len = (int)(ptr - s->file.data);
-	    if(s->len >= uip_mss())
-	      s->len = uip_mss();
+  for(s->tplseg = 0; s->tplseg < s->tpl->nseg; s->tplseg++) {
+    if(s->tpl->seg[s->tplseg].code) {
+      http_run_elua(s, s->tplseg);
+      PT_INIT(&s->luapt);
+      PT_WAIT_THREAD(&s->scriptpt, http_output_elua(s));
+      if(s->overrun) {
+        break;
       }
-      PT_WAIT_THREAD(&s->scriptpt, send_part_of_file(s));
-      s->file.data += s->len;
-      s->file.len -= s->len;
+    } else {
+      /* static text, straight from the cached page */
+      s->scriptptr = s->tpl->text + s->tpl->seg[s->tplseg].off;
+      s->scriptlen = s->tpl->seg[s->tplseg].len;
+      PT_WAIT_THREAD(&s->scriptpt, send_body(s));
     }
   }
 
   PT_END(&s->scriptpt);
 }
 /*---------------------------------------------------------------------------*/
+/* Extensions and content types, sorted for bsearch() */
+static const struct http_mime {
+  const char *ext;
+  const char *type;
+} http_mime_types[] = {
+  { http_cbor, http_content_type_cbor },
+  { http_css,  http_content_type_css },
+  { http_gif,  http_content_type_gif },
+  { http_htm,  http_content_type_html },
+  { http_html, http_content_type_html },
+  { http_ico,  http_content_type_ico },
+  { http_jpeg, http_content_type_jpg },
+  { http_jpg,  http_content_type_jpg },
+  { http_js,   http_content_type_js },
+  { http_json, http_content_type_json },
+  { http_lua,  http_content_type_html },
+  { http_pht,  http_content_type_html },
+  { http_png,  http_content_type_png },
+  { http_svg,  http_content_type_svg },
+  { http_txt,  http_content_type_plain },
+  { http_xml,  http_content_type_xml },
+};
+
+static int
+http_mime_cmp(const void *key, const void *elem)
+{
+  return strcmp((const char *)key, ((const struct http_mime *)elem)->ext);
+}
+
+static const char *
+http_mime_type(const char *filename)
+{
+  const struct http_mime *mime;
+  const char *ext = strrchr(filename, ISO_period);
+  char key[8];
+  int i;
+
+  if(ext == NULL) {
+    return http_content_type_binary;
+  }
+  for(i = 0; ext[i] != 0 && i < sizeof(key) - 1; i++) {
+    key[i] = tolower((unsigned char)ext[i]);
+  }
+  key[i] = 0;
+  mime = bsearch(key, http_mime_types, sizeof(http_mime_types) / sizeof(http_mime_types[0]),
+                 sizeof(http_mime_types[0]), http_mime_cmp);
+  return mime != NULL ? mime->type : http_content_type_plain;
+}
+/*---------------------------------------------------------------------------*/
+static char *
+http_append(char *ptr, const char *str)
+{
+  while(*str != 0) {
+    *ptr++ = *str++;
+  }
+  return ptr;
+}
+/*---------------------------------------------------------------------------*/
+/* The whole response header is built in the uIP buffer and leaves in a
+   single segment; it is built again for a retransmission. */
+static unsigned short
+generate_headers(void *state)
+{
+  struct httpd_state *s = (struct httpd_state *)state;
+  char *ptr = (char *)uip_appdata;
+
+  ptr = http_append(ptr, s->status);
+  if(s->status == http_header_101) {
+    /* the connection goes on as a websocket */
+    ptr = http_append(ptr, http_ws_upgrade);
+    ptr = http_append(ptr, s->ws->accept);
+    ptr = http_append(ptr, http_crnl);
+    ptr = http_append(ptr, http_crnl);
+    return ptr - (char *)uip_appdata;
+  }
+  /* an aborted script closes the connection after its 503 */
+  ptr = http_append(ptr, s->keepalive && !s->overrun ? http_connection_keepalive : http_connection_close);
+  if(s->gzip) {
+    ptr = http_append(ptr, http_content_encoding_gzip);
+  }
+  if(s->vary) {
+    ptr = http_append(ptr, http_vary_accept_encoding);
+  }
+
+  if(s->mtime != 0) {
+    ptr += sprintf(ptr, "Cache-Control: max-age=%d\r\nETag: ", HTTPD_MAX_AGE);
+    http_etag(s, ptr);
+    ptr += strlen(ptr);
+    ptr += sprintf(ptr, "\r\nLast-Modified: ");
+    ptr += http_date(s, ptr, 30);
+    ptr = http_append(ptr, http_crnl);
+  } else {
+    ptr = http_append(ptr, http_cache_control_nocache);
+  }
+
+  if(s->status == http_header_304) {
+    /* no body, and no entity headers */
+    ptr = http_append(ptr, http_crnl);
+    return ptr - (char *)uip_appdata;
+  }
+
+  if(s->status == http_header_206) {
+    ptr += sprintf(ptr, "Content-Range: bytes %ld-%ld/%ld\r\n", s->range_first, s->range_last, s->size);
+  } else if(s->status == http_header_416) {
+    ptr += sprintf(ptr, "Content-Range: bytes */%ld\r\n", s->size);
+  } else if(s->size >= 0) {
+    ptr = http_append(ptr, http_accept_ranges);
+  }
+
+  if(s->chunked) {
+    ptr = http_append(ptr, http_transfer_chunked);
+  } else if(s->content_len >= 0) {
+    ptr = http_append(ptr, http_content_length);
+    ptr += sprintf(ptr, "%ld\r\n", s->content_len);
+  }
+
+  ptr = http_append(ptr, s->content_type != NULL ? s->content_type : http_mime_type(s->filename));
+  return ptr - (char *)uip_appdata;
+}
+/*---------------------------------------------------------------------------*/
 static
-PT_THREAD(send_headers(struct httpd_state *s, const char *statushdr))
+PT_THREAD(send_headers(struct httpd_state *s))
 {
-  char *ptr;
+  PSOCK_BEGIN(&s->sout);
+  PSOCK_GENERATOR_SEND(&s->sout, generate_headers, s);
+  PSOCK_END(&s->sout);
+}
+/*---------------------------------------------------------------------------*/
+/* a control frame: the ping due, else ctlop with the payload in ctl */
+static unsigned short
+generate_ws_control(void *state)
+{
+  struct httpd_state *s = (struct httpd_state *)state;
+  char *ptr = (char *)uip_appdata;
 
+  if(s->ws->ping) {
+    return httpd_ws_header(ptr, HTTPD_WS_PING, TRUE, 0);
+  }
+  ptr += httpd_ws_header(ptr, s->ws->ctlop, TRUE, s->ws->ctllen);
+  memcpy(ptr, s->ws->ctl, s->ws->ctllen);
+  return ptr + s->ws->ctllen - (char *)uip_appdata;
+}
+/*---------------------------------------------------------------------------*/
+static
+PT_THREAD(send_ws_control(struct httpd_state *s))
+{
   PSOCK_BEGIN(&s->sout);
+  PSOCK_GENERATOR_SEND(&s->sout, generate_ws_control, s);
+  PSOCK_END(&s->sout);
+}
+/*---------------------------------------------------------------------------*/
+/* The websocket side of a connection: the handshake, then a frame of the
+   client answered, or a ping */
+static
+PT_THREAD(http_ws_output(struct httpd_state *s))
+{
+  PT_BEGIN(&s->scriptpt);
+
+  if(!s->ws->open) {
+    s->status = http_header_101;
+    PT_WAIT_THREAD(&s->scriptpt, send_headers(s));
+    s->ws->open = TRUE;
+    s->keepalive = TRUE;
+    httpd_url_free(&s->url);
+    PT_EXIT(&s->scriptpt);
+  }
 
-  PSOCK_SEND_STR(&s->sout, statushdr);
-
-  ptr = strrchr(s->filename, ISO_period);
-  if(ptr == NULL) {
-    PSOCK_SEND_STR(&s->sout, http_content_type_binary);
-  } else if(strncmp(http_html, ptr, 5) == 0 || strncmp(http_pht, ptr, 4) == 0 || strncmp(http_lua, ptr, 4) == 0) {
-    PSOCK_SEND_STR(&s->sout, http_content_type_html);
-  } else if(strncmp(http_css, ptr, 4) == 0) {
-    PSOCK_SEND_STR(&s->sout, http_content_type_css);
-  } else if(strncmp(http_png, ptr, 4) == 0) {
-    PSOCK_SEND_STR(&s->sout, http_content_type_png);
-  } else if(strncmp(http_gif, ptr, 4) == 0) {
-    PSOCK_SEND_STR(&s->sout, http_content_type_gif);
-  } else if(strncmp(http_jpg, ptr, 4) == 0) {
-    PSOCK_SEND_STR(&s->sout, http_content_type_jpg);
+  if(s->ws->ping) {
+    PT_WAIT_THREAD(&s->scriptpt, send_ws_control(s));
+    s->ws->ping = FALSE;
+  } else if(s->ws->ready == HTTPD_WS_PING) {
+    s->ws->ctlop = HTTPD_WS_PONG;
+    PT_WAIT_THREAD(&s->scriptpt, send_ws_control(s));
+  } else if(s->ws->ready == HTTPD_WS_CLOSE || !s->route->ws) {
+    /* the client closes, or the route has been removed */
+    if(s->ws->ready != HTTPD_WS_CLOSE) {
+      httpd_ws_close(s->ws, HTTPD_WS_NORMAL);
+    }
+    PT_WAIT_THREAD(&s->scriptpt, send_ws_control(s));
+    s->ws->closing = TRUE;
   } else {
-    PSOCK_SEND_STR(&s->sout, http_content_type_plain);
+    /* a message: what the handler writes goes back in text frames */
+    http_run_route(s, s->route);
+    s->ws->cont = FALSE;
+    PT_INIT(&s->luapt);
+    PT_WAIT_THREAD(&s->scriptpt, http_output_elua(s));
+    if(s->ws->cont) {
+      /* the handler ended just after a full buffer */
+      s->ws->ctlop = HTTPD_WS_CONT;
+      s->ws->ctllen = 0;
+      PT_WAIT_THREAD(&s->scriptpt, send_ws_control(s));
+    }
+  }
+  httpd_ws_done(s->ws);
+
+  PT_END(&s->scriptpt);
+}
+/*---------------------------------------------------------------------------*/
+/* the response can come from the cache: a GET of a script, or of a Lua
+   route that is not a stream; ext is the extension of filename */
+static int
+http_cacheable(struct httpd_state *s, struct httpd_route *route, const char *ext)
+{
+  if(s->post) {
+    return FALSE;
+  }
+  if(route != NULL) {
+    return route->fn == NULL && !route->stream;
+  }
+  return ext != NULL && strncmp(ext, http_lua, 4) == 0;
+}
+/*---------------------------------------------------------------------------*/
+/* the whole response is in write_buffer: keep it if the script asked */
+static void
+http_cache_keep(struct httpd_state *s)
+{
+  if(s->cacheable && s->cache_ttl > 0) {
+    httpd_cache_store(s->filename, &s->url, s->write_buffer,
+                      s->write_buffer_len, s->cache_ttl);
   }
-  PSOCK_END(&s->sout);
 }
 /*---------------------------------------------------------------------------*/
 static
 PT_THREAD(handle_output(struct httpd_state *s))
 {
   char *ptr;
+  char gzname[sizeof(s->filename) + sizeof(http_gz)];
+  struct httpd_route *route;
   
   PT_BEGIN(&s->outputpt);
 
-  if(!httpd_fs_open(s->filename, &s->file)) {
+  s->chunked = FALSE;
+  if(s->ws != NULL) {
+    /* the handshake, then what a frame of the client asks, or a ping */
+    PT_WAIT_THREAD(&s->outputpt, http_ws_output(s));
+    /* the handshake is the request, the messages are not measured */
+    http_stats_end(s);
+    if(s->ws->closing || !s->keepalive || s->overrun) {
+      /* closed, or frames were lost or cut while answering */
+      http_release(s);
+      PSOCK_CLOSE(&s->sout);
+    } else {
+      s->state = STATE_WAITING;
+    }
+    PT_EXIT(&s->outputpt);
+  }
+  s->gzip = FALSE;
+  s->vary = FALSE;
+  s->mtime = 0;
+  s->size = -1;
+  s->content_type = NULL;
+  s->stream = FALSE;
+  s->route = NULL;
+  s->cacheable = FALSE;
+  s->cache_ttl = 0;
+  route = s->url.overflow ? NULL : httpd_route_find(s->filename);
+  ptr = strchr(s->filename, ISO_period);
+  if(route == NULL && s->filename[0] != 0 && !(ptr != NULL && (strncmp(ptr, http_pht, 4) == 0 || strncmp(ptr, http_lua, 4) == 0))) {
+    /* a precompressed copy of a static file goes first. It is looked
+       for only when the client takes it, so any static file may depend
+       on Accept-Encoding for the caches */
+    s->vary = TRUE;
+    if(s->accept_gzip) {
+      strcpy(gzname, s->filename);
+      strcat(gzname, http_gz);
+      s->gzip = httpd_fs_open(gzname, &s->file);
+    }
+  }
+  if(s->url.overflow) {
+    /* the parameters did not fit */
+    s->content_len = 0;
+    s->status = http_header_413;
+    PT_WAIT_THREAD(&s->outputpt, send_headers(s));
+  } else if(route != NULL && route->ws) {
+    /* not a websocket handshake */
+    s->content_len = 0;
+    s->status = http_header_400;
+    PT_WAIT_THREAD(&s->outputpt, send_headers(s));
+  } else if((s->cacheable = http_cacheable(s, route, ptr)) &&
+            (s->cached = httpd_cache_get(s->filename, &s->url)) != NULL) {
+    /* kept from a previous run, the script is not run again */
+    s->route = route;
+    if(route != NULL) {
+      s->content_type = route->type != NULL ? route->type : http_content_type_html;
+    }
+    s->content_len = s->cached->len;
+    s->status = http_header_200;
+    PT_WAIT_THREAD(&s->outputpt, send_headers(s));
+    s->scriptptr = (char *)httpd_cache_body(s->cached);
+    s->scriptlen = s->cached->len;
+    PT_WAIT_THREAD(&s->outputpt, send_body(s));
+  } else if(route != NULL) {
+    /* answered by a function, there is no file behind it */
+    s->content_type = route->type != NULL ? route->type : http_content_type_html;
+    s->route = route;
+    s->stream = route->stream;
+    http_run_route(s, route);
+    PT_INIT(&s->luapt);
+    PT_WAIT_THREAD(&s->outputpt, http_output_first(s));
+    if(s->overrun) {
+      s->content_len = 0;
+      s->status = http_header_503;
+    } else if(s->co == NULL && !s->stream) {
+      s->content_len = s->write_buffer_len;
+      s->status = http_header_200;
+      http_cache_keep(s);
+    } else {
+      http_stream_body(s);
+      s->status = http_header_200;
+    }
+    PT_WAIT_THREAD(&s->outputpt, send_headers(s));
+    PT_INIT(&s->luapt);
+    if(s->overrun) {
+      /* the headers were all */
+    } else if(s->stream && s->route->fn != NULL) {
+      /* a C event source, called again at every poll */
+      PT_WAIT_THREAD(&s->outputpt, http_output_stream(s));
+    } else {
+      PT_WAIT_THREAD(&s->outputpt, http_output_elua(s));
+    }
+  } else if(s->filename[0] == 0 || (!s->gzip && !httpd_fs_open(s->filename, &s->file))) {
     httpd_fs_open(http_404_html, &s->file);
+    http_phase(s, HTTPD_PHASE_OPEN);
     strcpy(s->filename, http_404_html);
-    PT_WAIT_THREAD(&s->outputpt,
-		   send_headers(s,
-		   http_header_404));
+    s->content_len = s->file.len;
+    s->status = http_header_404;
+    PT_WAIT_THREAD(&s->outputpt, send_headers(s));
     PT_WAIT_THREAD(&s->outputpt,
 		   send_file(s));
   } else {
-    PT_WAIT_THREAD(&s->outputpt, send_headers(s, http_header_200));
+    http_phase(s, HTTPD_PHASE_OPEN);
     ptr = strchr(s->filename, ISO_period);
     if(ptr != NULL && strncmp(ptr, http_pht, 4) == 0) {
+      /* the length of a page is not known before it has been sent */
+      http_stream_body(s);
+      s->tpl = httpd_tpl_get(s->filename, &s->file, HTTPD_TPL_PAGE);
+      s->t_load += httpd_stats_clock() - s->t_mark;
+      s->status = http_header_200;
+      PT_WAIT_THREAD(&s->outputpt, send_headers(s));
       s->new_pht_page = TRUE;	/* force a new instance of the elua interpreter */
-      PT_INIT(&s->scriptpt);
-      PT_WAIT_THREAD(&s->outputpt, handle_elua_tags(s));
+      if(s->tpl != NULL) {
+        PT_INIT(&s->scriptpt);
+        PT_WAIT_THREAD(&s->outputpt, handle_elua_tags(s));
+      }
     }else if(ptr != NULL && strncmp(ptr, http_lua, 4) == 0) {
-          PT_INIT(&s->scriptpt);
-          PT_WAIT_THREAD(&s->outputpt, handle_elua_scripts(s));
+      /* run the script first: if its output fits in the buffer
+         the length is known */
+      s->write_buffer_len = 0;
+      s->tpl = httpd_tpl_get(s->filename, &s->file, HTTPD_TPL_SCRIPT);
+      s->t_load += httpd_stats_clock() - s->t_mark;
+      if(s->tpl != NULL)
+        http_run_elua(s, 0);
+      PT_INIT(&s->luapt);
+      PT_WAIT_THREAD(&s->outputpt, http_output_first(s));
+      if(s->overrun) {
+        s->content_len = 0;
+        s->status = http_header_503;
+      } else if(s->co == NULL) {
+        s->content_len = s->write_buffer_len;
+        s->status = http_header_200;
+        http_cache_keep(s);
+      } else {
+        http_stream_body(s);
+        s->status = http_header_200;
+      }
+      PT_WAIT_THREAD(&s->outputpt, send_headers(s));
+      if(!s->overrun) {
+        PT_INIT(&s->luapt);
+        PT_WAIT_THREAD(&s->outputpt, http_output_elua(s));
+      }
+    } else if(http_validators(s)) {
+      /* not modified: the file is closed without reading it */
+      httpd_fs_close(&s->file);
+      s->content_len = -1;
+      s->status = http_header_304;
+      PT_WAIT_THREAD(&s->outputpt, send_headers(s));
     } else {
+      s->status = http_apply_range(s);
+      s->content_len = s->file.len;
+      PT_WAIT_THREAD(&s->outputpt, send_headers(s));
       PT_WAIT_THREAD(&s->outputpt,
 		     send_file(s));
     }
   }
-  PSOCK_CLOSE(&s->sout);
+  if(s->chunked && !s->overrun) {
+    PT_WAIT_THREAD(&s->outputpt, send_last_chunk(s));
+  }
+  http_stats_end(s);
+  http_release(s);
+  if(s->keepalive && !s->overrun) {
+    /* wait for the next request on the same connection */
+    s->state = STATE_WAITING;
+  } else {
+    PSOCK_CLOSE(&s->sout);
+  }
   PT_END(&s->outputpt);
 }
 /*---------------------------------------------------------------------------*/
 static
 PT_THREAD(handle_input(struct httpd_state *s))
 {
-  char *params;
+  unsigned short len;
+  int i;
+
   PSOCK_BEGIN(&s->sin);
 
-  PSOCK_READTO(&s->sin, ISO_space);
-  
-  if(strncmp(s->inputbuf, http_get, 4) != 0) {
-    PSOCK_CLOSE_EXIT(&s->sin);
-  }
-  PSOCK_READTO(&s->sin, ISO_space);
+  while(1) {
+    PSOCK_READTO(&s->sin, ISO_space);
 
-  if(s->inputbuf[0] != ISO_slash) {
-    PSOCK_CLOSE_EXIT(&s->sin);
-  }
+    if(strncmp(s->inputbuf, http_get, 4) != 0 && strncmp(s->inputbuf, http_post, 5) != 0) {
+      PSOCK_CLOSE_EXIT(&s->sin);
+    }
+    s->post = (strncmp(s->inputbuf, http_post, 5) == 0);
+
+    /* the target can be of any length, it is decoded as it comes: the
+       path in filename, the query string in the parameters */
+    httpd_url_init(&s->url, s->filename, sizeof(s->filename));
+    httpd_url_start(&s->url, HTTPD_URL_PATH);
+    do {
+      PSOCK_READ_AVAILABLE(&s->sin);
+      len = httpd_url_feed(&s->url, (char *)s->sin.readptr, s->sin.readlen, ISO_space);
+      s->sin.readptr += len;
+      s->sin.readlen -= len;
+    } while(s->url.state != HTTPD_URL_DONE);
+
+    if(s->filename[0] != ISO_slash) {
+      PSOCK_CLOSE_EXIT(&s->sin);
+    }
 
-  if(s->inputbuf[1] == ISO_space) {
-	memset(s->filename,0,sizeof(s->filename));
-    strncpy(s->filename, http_index_pht, sizeof(http_index_pht));
-  } else {
-    s->inputbuf[PSOCK_DATALEN(&s->sin) - 1] = 0;
-    params = strchr(s->inputbuf, ISO_question);
-	if( params != NULL)  {
-	  *params = 0; /* change the ? character with the end of filename string */
-	  strcpy(s->filename, &s->inputbuf[0]);
-      strcpy(s->http_params, params + 1);
-	} else {
+    if(s->url.pathlen >= sizeof(s->filename)) {
+      /* no such file can exist */
+      s->filename[0] = 0;
+    } else if(s->filename[1] == 0) {
+      strcpy(s->filename, http_index_pht);
+    }
+
+    /* rest of the request line: HTTP/1.1 connections are persistent */
+    PSOCK_READTO(&s->sin, ISO_nl);
+    s->http11 = (strncmp(s->inputbuf, http_11, 8) == 0);
+    s->keepalive = s->http11;
+    s->accept_gzip = FALSE;
+    s->accept_cbor = FALSE;
+    s->cond_type = HTTPD_COND_NONE;
+    s->range = FALSE;
+    s->if_range = FALSE;
+    s->body_left = 0;
+    s->form = FALSE;
+    s->expect_continue = FALSE;
+    s->upgrade = FALSE;
+
+    /* header lines up to the empty one */
+    while(1) {
+      PSOCK_READTO(&s->sin, ISO_nl);
+      if(PSOCK_DATALEN(&s->sin) <= 2) {
+        break;
+      }
       s->inputbuf[PSOCK_DATALEN(&s->sin) - 1] = 0;
-      strncpy(s->filename, &s->inputbuf[0], sizeof(s->filename));
-      s->http_params[0] = 0;
-	}
-  }
+      for(i = 0; s->inputbuf[i] != 0 && s->inputbuf[i] != ISO_colon; i++) {
+        s->inputbuf[i] = tolower((unsigned char)s->inputbuf[i]);
+      }
+      if(strncmp(s->inputbuf, http_accept_encoding, 16) == 0) {
+        s->accept_gzip = (strstr(s->inputbuf, http_gzip) != NULL);
+      } else if(strncmp(s->inputbuf, http_accept, 7) == 0) {
+        for(; s->inputbuf[i] != 0; i++) {
+          s->inputbuf[i] = tolower((unsigned char)s->inputbuf[i]);
+        }
+        s->accept_cbor = (strstr(s->inputbuf, http_application_cbor) != NULL);
+      } else if(strncmp(s->inputbuf, http_if_none_match, 14) == 0) {
+        /* takes precedence over the date */
+        http_set_cond(s, HTTPD_COND_ETAG, &s->inputbuf[i + 1]);
+      } else if(strncmp(s->inputbuf, http_if_modified_since, 18) == 0) {
+        if(s->cond_type == HTTPD_COND_NONE) {
+          http_set_cond(s, HTTPD_COND_DATE, &s->inputbuf[i + 1]);
+        }
+      } else if(strncmp(s->inputbuf, http_range, 6) == 0) {
+        http_set_range(s, &s->inputbuf[i + 1]);
+      } else if(strncmp(s->inputbuf, http_if_range, 9) == 0) {
+        s->if_range = TRUE;
+        if(s->cond_type == HTTPD_COND_NONE) {
+          http_set_cond(s, HTTPD_COND_RANGE, &s->inputbuf[i + 1]);
+        }
+      } else if(strncmp(s->inputbuf, http_content_length_hdr, 15) == 0) {
+        s->body_left = strtol(&s->inputbuf[i + 1], NULL, 10);
+      } else if(strncmp(s->inputbuf, http_content_type, 13) == 0) {
+        for(; s->inputbuf[i] != 0; i++) {
+          s->inputbuf[i] = tolower((unsigned char)s->inputbuf[i]);
+        }
+        s->form = (strstr(s->inputbuf, http_form_urlencoded) != NULL);
+      } else if(strncmp(s->inputbuf, http_expect, 7) == 0) {
+        s->expect_continue = (strstr(s->inputbuf, http_100_continue) != NULL);
+      } else if(strncmp(s->inputbuf, http_upgrade, 8) == 0) {
+        for(; s->inputbuf[i] != 0; i++) {
+          s->inputbuf[i] = tolower((unsigned char)s->inputbuf[i]);
+        }
+        s->upgrade = (strstr(s->inputbuf, http_websocket) != NULL);
+      } else if(strncmp(s->inputbuf, http_sec_websocket_key, 18) == 0) {
+        httpd_ws_free(&s->ws);
+        s->ws = httpd_ws_new(&s->inputbuf[i + 1]);
+      } else if(strncmp(s->inputbuf, http_connection, 11) == 0) {
+        for(; s->inputbuf[i] != 0; i++) {
+          s->inputbuf[i] = tolower((unsigned char)s->inputbuf[i]);
+        }
+        if(strstr(s->inputbuf, "close") != NULL) {
+          s->keepalive = FALSE;
+        } else if(strstr(s->inputbuf, "keep-alive") != NULL) {
+          s->keepalive = TRUE;
+        }
+      }
+    }
 
-  s->state = STATE_OUTPUT;
+    if(s->ws != NULL) {
+      /* a handshake only for a websocket route */
+      s->route = httpd_route_find(s->filename);
+      if(!s->upgrade || s->route == NULL || !s->route->ws) {
+        httpd_ws_free(&s->ws);
+      }
+    }
 
-  while(1) {
-    PSOCK_READTO(&s->sin, ISO_nl);
+    if(s->body_left > 0) {
+      if(s->expect_continue && s->sin.readlen == 0) {
+        /* not when the body came with the headers: the interim answer
+           would be written over it in the uIP buffer */
+        PSOCK_SEND_STR(&s->sin, http_header_100);
+      }
+      /* a form adds to the parameters, any other body is kept for the
+         scripts if it is not too big */
+      if(s->form) {
+        httpd_url_start(&s->url, HTTPD_URL_KEY);
+      } else {
+        httpd_url_body(&s->url, s->body_left);
+      }
+      while(s->body_left > 0) {
+        PSOCK_READ_AVAILABLE(&s->sin);
+        len = s->sin.readlen < s->body_left ? s->sin.readlen : s->body_left;
+        httpd_url_feed(&s->url, (char *)s->sin.readptr, len, -1);
+        s->sin.readptr += len;
+        s->sin.readlen -= len;
+        s->body_left -= len;
+      }
+      httpd_url_end(&s->url);
+    }
 
-    if(strncmp(s->inputbuf, http_referer, 8) == 0) {
-      s->inputbuf[PSOCK_DATALEN(&s->sin) - 2] = 0;
+    s->new_request = TRUE;
+    http_budget(s);
+    httpd_stats()->requests++;
+    http_phase(s, HTTPD_PHASE_PARSE);
+    s->state = STATE_OUTPUT;
+    PSOCK_WAIT_UNTIL(&s->sin, s->state == STATE_WAITING);
+
+    /* after the handshake, the frames of the client up to its close */
+    while(s->ws != NULL) {
+      PSOCK_READ_AVAILABLE(&s->sin);
+      len = httpd_ws_feed(s->ws, (char *)s->sin.readptr, s->sin.readlen);
+      s->sin.readptr += len;
+      s->sin.readlen -= len;
+      if(s->ws->ready) {
+        s->state = STATE_OUTPUT;
+        PSOCK_WAIT_UNTIL(&s->sin, s->state == STATE_WAITING);
+      }
     }
   }
   
   PSOCK_END(&s->sin);
 }
 /*---------------------------------------------------------------------------*/
+/* keep the bytes a client sent after its request, they are the next
+   (pipelined) requests */
+static void
+http_stash(struct httpd_state *s, const char *data, unsigned short len)
+{
+  if(s->pipelen + len > sizeof(s->pipebuf)) {
+    /* no room: close after this answer, the client asks again */
+    s->keepalive = FALSE;
+    s->pipelen = 0;
+    return;
+  }
+  memmove(s->pipebuf + s->pipelen, data, len);
+  s->pipelen += len;
+}
+/*---------------------------------------------------------------------------*/
 static void
 handle_connection(struct httpd_state *s)
 {
-  handle_input(s);
   if(s->state == STATE_OUTPUT) {
+    if(uip_newdata()) {
+      http_stash(s, uip_appdata, uip_datalen());
+    }
+  } else {
+    handle_input(s);
+  }
+
+  while(s->state == STATE_OUTPUT) {
+    if(s->sin.readlen > 0) {
+      http_stash(s, (char *)s->sin.readptr, s->sin.readlen);
+      s->sin.readlen = 0;
+    }
     handle_output(s);
+    if(s->state != STATE_WAITING) {
+      break;
+    }
+    if(s->pipelen > 0) {
+      /* answer the next pipelined request right away */
+      s->sin.readptr = (u8_t *)s->pipebuf;
+      s->sin.readlen = s->pipelen;
+      s->pipelen = 0;
+      http_stats_begin(s);
+    }
+    /* otherwise this only gets the input side waiting for new data */
+    handle_input(s);
   }
 }
 /*---------------------------------------------------------------------------*/
@@ -357,31 +1073,17 @@ void
 httpd_appcall(void)
 {
   struct httpd_state *s;
-  char   ripadress_isnew;
-  int    i;
 
   s = (struct httpd_state *)&(uip_conn->appstate);
 
   /* save the remote ip address */
   uip_ipaddr_copy(s->ripaddr,uip_conn->ripaddr);
 
-  s->L = NULL;
-  ripadress_isnew = TRUE;
-
-  /* Is the remote ip already present */
-  for (i=0; i < WEB_MAX_CLIENT; i++)
-  {
-    if(uip_ipaddr_cmp(s->ripaddr,connection[i].ripaddr))
-    {
-      s->http_connection_nr = i;
-	  s->L = connection[s->http_connection_nr].L;
-	  uip_ipaddr_copy(connection[s->http_connection_nr].ripaddr,s->ripaddr);
-	  ripadress_isnew = FALSE;
-	  break;
-    }
-  }
-
   if(uip_closed() || uip_aborted() || uip_timedout()) {
+    if(s->timed) {
+      httpd_stats()->resets++;
+    }
+    http_release(s);
   } else if(uip_connected()) {
     PSOCK_INIT(&s->sin, s->inputbuf, sizeof(s->inputbuf) - 1);
     PSOCK_INIT(&s->sout, s->inputbuf, sizeof(s->inputbuf) - 1);
@@ -390,174 +1092,537 @@ httpd_appcall(void)
     s->timer = 0;
     s->filename[0]=0;
     s->len=0;
+    s->keepalive = FALSE;
+    s->pipelen = 0;
+    s->sleep = 0;
+    s->runnable = FALSE;
+    s->timed = FALSE;
+    s->write_hwm = 0;
+    s->heap_hwm = 0;
+    s->cached = NULL;
+    s->L = NULL;
     handle_connection(s);
   } else if(s != NULL) {
-    if(uip_poll()) {
+    if(resuming) {
+      /* a handler goes on, the time has not moved */
+    } else if(uip_poll()) {
       ++s->timer;
+      if(s->co != NULL && s->sleep == 0 && s->runtime < 0xffff) {
+	++s->runtime;
+      }
+      if(s->sleep > 0) {
+	--s->sleep;
+      }
+      if(s->ws != NULL && s->state == STATE_WAITING && s->timer >= HTTPD_SSE_KEEPALIVE) {
+	/* silent websocket: the pong will say if the client is there */
+	s->ws->ping = TRUE;
+	s->state = STATE_OUTPUT;
+      } else if(s->state == STATE_WAITING && s->ws == NULL && s->timer >= HTTPD_IDLE_TIMEOUT) {
+	/* idle persistent connection */
+	httpd_stats()->idle++;
+	http_release(s);
+	uip_close();
+	return;
+      }
       if(s->timer >= 20) {
+	httpd_stats()->timeouts++;
+	http_release(s);
 	uip_abort();
+	return;
       }
     } else {
       s->timer = 0;
+      if(uip_newdata() && s->state == STATE_WAITING && s->ws == NULL && !s->timed) {
+	http_stats_begin(s);
+      }
     }
     handle_connection(s);
   } else {
     uip_abort();
   }
+}
 
-  /* new client ip */
-  if(ripadress_isnew)
-  {
-	  /* try to insert the ip in an empty place */
-	  for (i=0; i < WEB_MAX_CLIENT; i++)
-	  {
-		if(connection[i].ripaddr[0]==0 && connection[i].ripaddr[1]==0)
-		{
-          s->http_connection_nr = i;
-		  uip_ipaddr_copy(connection[s->http_connection_nr].ripaddr,s->ripaddr);
-		  connection[s->http_connection_nr].L = s->L;
-		  break;
-		}
-	  }
-	  /* no space free, use the an used one  */
-	  if(i == WEB_MAX_CLIENT)
-	  {
-	    if(s->http_connection_nr < (WEB_MAX_CLIENT - 1))
-	      s->http_connection_nr ++;
-	    else
-	      s->http_connection_nr = 0;
-
-	    uip_ipaddr_copy(connection[s->http_connection_nr].ripaddr,s->ripaddr);
-	    connection[s->http_connection_nr].L = s->L;
-	   }
-  }
-  else
-  {
-	/* an old client has changed the elua struct */
-    if(s->L != connection[s->http_connection_nr].L)
-      connection[s->http_connection_nr].L = s->L;
+/*---------------------------------------------------------------------------*/
+/* Poll conn right away if its handler gave the CPU back, so that a long
+   script runs between the packets of the others. Returns TRUE if uip_len
+   may have to be sent. */
+int
+httpd_resume(struct uip_conn *conn)
+{
+  struct httpd_state *s = (struct httpd_state *)&conn->appstate;
+
+  if(conn->tcpstateflags == UIP_CLOSED || !s->runnable) {
+    return FALSE;
   }
+  /* if the poll is dropped for data in flight, the ack resumes it */
+  s->runnable = FALSE;
+  resuming = TRUE;
+  uip_poll_conn(conn);
+  resuming = FALSE;
+  return TRUE;
+}
 
+/*---------------------------------------------------------------------------*/
+/* A comment line for an event stream that has been silent too long.
+   Returns TRUE if there is something to send. */
+static int
+http_sse_idle(struct httpd_state *s)
+{
+  if(s->stream && s->write_buffer_len == 0 && s->timer >= HTTPD_SSE_KEEPALIVE)
+    http_buffer_data(s, http_sse_keepalive, sizeof(http_sse_keepalive) - 1);
+  return s->write_buffer_len > 0;
 }
 
 /*---------------------------------------------------------------------------*/
+/* Send the Lua output: the buffer, then what print() could not buffer,
+   resuming the script each time it yielded on a full buffer, an event
+   or after the polls it asked to sleep */
 static
 PT_THREAD(http_output_elua(struct httpd_state *s))
 {
-  PSOCK_BEGIN(&s->sout);
-  PSOCK_SEND(&s->sout, s->write_buffer, s->write_buffer_len);
-  PSOCK_END(&s->sout);
+  _ssize_t n;
+
+  PT_BEGIN(&s->luapt);
+
+  while(1) {
+    s->scriptptr = s->write_buffer;
+    s->scriptlen = s->write_buffer_len;
+    if(s->ws != NULL) {
+      s->ws->fin = (s->co == NULL && s->pendlen == 0);
+    }
+    PT_WAIT_THREAD(&s->luapt, send_body(s));
+    s->write_buffer_len = 0;
+
+    if(s->pendlen > 0) {
+      if(s->pendraw) {
+        n = http_buffer_data(s, s->pending, s->pendlen);
+      } else {
+        n = http_buffer_str(s, s->pending, s->pendlen);
+      }
+      s->pending += n;
+      s->pendlen -= n;
+    } else if(s->pendjson == HTTPD_JSON_WRITING) {
+      if(http_buffer_json(s, s->co, &s->jsonerr)) {
+        s->pendjson = HTTPD_JSON_WRITTEN;
+      }
+    } else if(s->co != NULL) {
+      while(s->sleep > 0) {
+        /* the polls count it down; a sleep starts a new budget */
+        http_budget(s);
+        PT_WAIT_UNTIL(&s->luapt, s->sleep == 0 || http_sse_idle(s));
+        if(s->write_buffer_len > 0) {
+          s->scriptptr = s->write_buffer;
+          s->scriptlen = s->write_buffer_len;
+          PT_WAIT_THREAD(&s->luapt, send_body(s));
+          s->write_buffer_len = 0;
+        }
+      }
+      /* after a slice the main loop comes back at once */
+      PT_WAIT_UNTIL(&s->luapt, !s->runnable);
+      http_resume_elua(s);
+    } else {
+      break;
+    }
+  }
+
+  PT_END(&s->luapt);
 }
 
 /*---------------------------------------------------------------------------*/
+/* Before the headers: a script that only gave the CPU back goes on, so
+   that a short output still gets a length and an abort gets a 503 */
 static
-int http_run_elua (struct httpd_state *s, char *data, int len)
+PT_THREAD(http_output_first(struct httpd_state *s))
 {
-#define getn(L,n) (luaL_checktype(L, n, LUA_TTABLE), luaL_getn(L, n))
-  int error;
-  int i,c;
-  int tableIdx;
-  char str[20];
-  char pair = FALSE;
-
-  /* clean the elua output buffer */
-  s->write_buffer_len = 0;
-  /* set the http_state for elua write function */
-  set_httpd_state_struct (s);
+  PT_BEGIN(&s->luapt);
 
-  if ((s->new_pht_page == TRUE) && (s->L != NULL)) {
-	lua_close(s->L);
-	s->L = NULL;
-	s->new_pht_page = FALSE;
+  while(s->co != NULL && s->runnable) {
+    PT_WAIT_UNTIL(&s->luapt, !s->runnable);
+    http_resume_elua(s);
   }
 
+  PT_END(&s->luapt);
+}
 
-  if (s->L == NULL) {
-    s->L = lua_open();   /* opens Lua */
+/*---------------------------------------------------------------------------*/
+/* Send the events of a C handler: it is called at every poll until the
+   client goes away */
+static
+PT_THREAD(http_output_stream(struct httpd_state *s))
+{
+  u32 t;
 
-    if (s->L == NULL) {
-      fprintf (stderr,"cannot create state: not enough memory\n");
-      return -1;
+  PT_BEGIN(&s->luapt);
+
+  while(1) {
+    if(s->write_buffer_len > 0) {
+      s->scriptptr = s->write_buffer;
+      s->scriptlen = s->write_buffer_len;
+      PT_WAIT_THREAD(&s->luapt, send_body(s));
+      s->write_buffer_len = 0;
+    }
+    /* until the next poll */
+    s->sleep = 1;
+    PT_WAIT_UNTIL(&s->luapt, s->sleep == 0);
+    if(s->route->fn == NULL) {
+      /* the route has been removed */
+      break;
     }
+    set_httpd_state_struct(s);
+    t = httpd_stats_clock();
+    s->route->fn(s);
+    s->t_exec += httpd_stats_clock() - t;
+    set_httpd_state_struct(NULL);
+    http_sse_idle(s);
+  }
 
-    lua_gc(s->L, LUA_GCSTOP, 0);  /* stop collector during initialization */
-    luaL_openlibs(s->L);  /* open libraries */
-    lua_gc(s->L, LUA_GCRESTART, 0);
+  PT_END(&s->luapt);
+}
 
-    lua_createtable(s->L, 0, 1);      // create new table
-    lua_setfield(s->L, LUA_GLOBALSINDEX, HTTP_PARAMS_TABLE);  // add it to global context
+/*---------------------------------------------------------------------------*/
+/* the body length is not known: send it in chunks, or close the
+   connection after it for HTTP/1.0 clients */
+static void
+http_stream_body(struct httpd_state *s)
+{
+  s->content_len = -1;
+  if(s->http11) {
+    s->chunked = TRUE;
+  } else {
+    s->keepalive = FALSE;
+  }
+}
 
-    // reset table on stack
-    lua_pop(s->L, 1);                                         // pop table (nil value) from stack
-    lua_getfield(s->L, LUA_GLOBALSINDEX, HTTP_PARAMS_TABLE);  // push table onto stack
+/*---------------------------------------------------------------------------*/
+static void
+http_write_hwm(struct httpd_state *s)
+{
+  if(s->write_buffer_len > s->write_hwm) {
+    s->write_hwm = s->write_buffer_len;
+  }
+  if(s->write_buffer_len > httpd_stats()->write_hwm) {
+    httpd_stats()->write_hwm = s->write_buffer_len;
+  }
+}
 
-    fprintf(stderr,"remote ip: %d.%d.%d.%d [%d]\n", uip_ipaddr1(s->ripaddr), uip_ipaddr2(s->ripaddr),
-                                             uip_ipaddr3(s->ripaddr), uip_ipaddr4(s->ripaddr),s->http_connection_nr);
-  } else {
-    fprintf(stderr,"         : %d.%d.%d.%d [%d]\n", uip_ipaddr1(s->ripaddr), uip_ipaddr2(s->ripaddr),
-    			                               uip_ipaddr3(s->ripaddr), uip_ipaddr4(s->ripaddr),s->http_connection_nr);
+/*---------------------------------------------------------------------------*/
+/* Append the script output to the write buffer, newlines are dropped.
+   Returns the number of bytes of ptr used. */
+_ssize_t http_buffer_str(struct httpd_state *s, const char *ptr, _ssize_t len)
+{
+  _ssize_t i;
+
+  for(i = 0; i < len; i++) {
+    if(ptr[i] == ISO_nl)
+      continue;
+    if(s->write_buffer_len >= WRITE_BUFFER_SIZE)
+      break;
+    s->write_buffer[s->write_buffer_len++] = ptr[i];
   }
+  http_write_hwm(s);
+  return i;
+}
 
-   lua_getglobal(s->L, HTTP_PARAMS_TABLE);
-   tableIdx =  lua_gettop(s->L);
-   c = getn(s->L, tableIdx);
-
-   if(c > 0 ) {
-   lua_rawgeti(s->L, tableIdx, 1);  /* push first element */
-    /* shift elements left */
-    for (i = 2; i < c; i++) {
-      lua_rawgeti(s->L, tableIdx, i);
-      lua_rawseti(s->L, tableIdx, i-1);
-    }
-   }
-
-    if(s->http_params[0] != 0)
-    {
-      /* here are http parameters */
-      for (i = 0, c = 0; i < sizeof(s->http_params) ; i++)
-      {
-        if (s->http_params[i] != '+')
-          str[c] = s->http_params[i];
-        else
-          str[c] = ' ';
-
-        if ((s->http_params[i] == '=') && (s->http_params[i+1] != 0))
-        {
-          str[ c ] = 0;
-          lua_pushstring(s->L,str);
-          c = -1;
-          pair = TRUE;
-        }
+/*---------------------------------------------------------------------------*/
+/* Append len bytes to the write buffer as they are. Returns the number of
+   bytes of ptr used. */
+_ssize_t http_buffer_data(struct httpd_state *s, const char *ptr, _ssize_t len)
+{
+  if(len > WRITE_BUFFER_SIZE - s->write_buffer_len)
+    len = WRITE_BUFFER_SIZE - s->write_buffer_len;
+  memcpy(s->write_buffer + s->write_buffer_len, ptr, len);
+  s->write_buffer_len += len;
+  http_write_hwm(s);
+  return len;
+}
 
-        if ((s->http_params[i] == 0) && (pair == TRUE))
-        {
-          str[ c ] = 0;
-          lua_pushstring(s->L,str);
-          lua_settable(s->L, -3);             // add key-value pair to table
-          break;
-        }
-        if ((s->http_params[i] == '&') && (pair == TRUE))
-        {
-          str[ c ] = 0;
-          lua_pushstring(s->L,str);
-          lua_settable(s->L, -3);             // add key-value pair to table
-          c = -1;
-          pair = FALSE;
-        }
-        c++;
+/*---------------------------------------------------------------------------*/
+/* Append what fits of the document json.write() or httpd.write() writes
+   on L. Returns TRUE once it is complete, *err set if it was cut. */
+int http_buffer_json(struct httpd_state *s, lua_State *L, const char **err)
+{
+  size_t len;
+  int done;
+
+  done = JSON_write_step(L, 1, s->write_buffer + s->write_buffer_len,
+                         WRITE_BUFFER_SIZE - s->write_buffer_len, &len, err);
+  s->write_buffer_len += len;
+  http_write_hwm(s);
+  return done;
+}
+
+/*---------------------------------------------------------------------------*/
+/* Write in out (if not NULL) a server-sent event: the event line if event
+   is not NULL, a data line for each line of data, then a blank line.
+   Returns its length. */
+size_t http_sse_frame(char *out, const char *event, const char *data, size_t len)
+{
+  size_t i, size, lines = 1;
+  char *ptr = out;
+
+  for(i = 0; i < len; i++) {
+    if(data[i] == ISO_nl)
+      lines++;
+  }
+  size = len + lines * (sizeof(http_sse_data) - 1) + 1 + 1;
+  if(event != NULL)
+    size += sizeof(http_sse_event) - 1 + strlen(event) + 1;
+  if(out == NULL)
+    return size;
+
+  if(event != NULL) {
+    ptr = http_append(ptr, http_sse_event);
+    ptr = http_append(ptr, event);
+    *ptr++ = ISO_nl;
+  }
+  ptr = http_append(ptr, http_sse_data);
+  for(i = 0; i < len; i++) {
+    *ptr++ = data[i];
+    if(data[i] == ISO_nl)
+      ptr = http_append(ptr, http_sse_data);
+  }
+  *ptr++ = ISO_nl;
+  *ptr++ = ISO_nl;
+  return size;
+}
+
+/*---------------------------------------------------------------------------*/
+/* Append an event to the write buffer of an event stream. Returns FALSE,
+   writing nothing, when it does not fit. */
+int http_sse_send(struct httpd_state *s, const char *event, const char *data, size_t len)
+{
+  size_t size = http_sse_frame(NULL, event, data, len);
+
+  if(size > (size_t)(WRITE_BUFFER_SIZE - s->write_buffer_len))
+    return FALSE;
+  http_sse_frame(s->write_buffer + s->write_buffer_len, event, data, len);
+  s->write_buffer_len += size;
+  return TRUE;
+}
+
+/*---------------------------------------------------------------------------*/
+/* Run the coroutine of the current block until it ends or yields on a full
+   buffer. Returns TRUE if it yielded. */
+static int
+http_resume_elua(struct httpd_state *s)
+{
+  int status, nargs = 0;
+  u32 t;
+  int kb;
+
+  if(s->co == NULL)
+    return FALSE;
+
+  if(lua_status(s->co) == LUA_YIELD) {
+    lua_settop(s->co, 0);  /* the text it yielded has been sent */
+    if(s->pendjson == HTTPD_JSON_WRITTEN) {
+      /* what json.write() returns */
+      if(s->jsonerr != NULL) {
+        lua_pushnil(s->co);
+        lua_pushstring(s->co, s->jsonerr);
+        nargs = 2;
+      } else {
+        lua_pushboolean(s->co, 1);
+        nargs = 1;
       }
-      lua_pop(s->L, 1);                     // pop table from stack
+      s->pendjson = 0;
     }
+  } else {
+    /* first run: the function and its arguments are on the stack */
+    nargs = lua_gettop(s->co) - 1;
+  }
+  s->pendraw = FALSE;
+  set_httpd_state_struct(s);
+  t = httpd_stats_clock();
+  status = lua_resume(s->co, nargs);
+  s->t_exec += httpd_stats_clock() - t;
+  set_httpd_state_struct(NULL);
+  /* the state of the coroutine, the pages of a client share it */
+  kb = lua_gc(s->co, LUA_GCCOUNT, 0);
+  if(kb > s->heap_hwm) {
+    s->heap_hwm = kb;
+  }
+  if(kb > httpd_stats()->heap_hwm) {
+    httpd_stats()->heap_hwm = kb;
+  }
+  if(status == LUA_YIELD) {
+    /* nothing is yielded by httpd.sleep(), json.write() yields the
+       state of its document */
+    s->pending = NULL;
+    if(lua_gettop(s->co) > 0 && !s->pendjson)
+      s->pending = lua_tolstring(s->co, -1, &s->pendlen);
+    if(s->pending == NULL)
+      s->pendlen = 0;
+    return TRUE;
+  }
+
+  if(status != 0) {
+    fprintf(stderr,"%s\n", lua_tostring(s->co, -1));
+  }
+  http_end_elua(s);
+  return FALSE;
+}
+
+/*---------------------------------------------------------------------------*/
+static void
+http_end_elua(struct httpd_state *s)
+{
+  if(s->co != NULL) {
+    httpd_lua_bind(s->co, NULL);
+    luaL_unref(s->co, LUA_REGISTRYINDEX, s->co_ref);
+    s->co = NULL;
+  }
+  s->pendlen = 0;
+  s->pendjson = 0;
+  s->sleep = 0;
+  s->runnable = FALSE;
+}
 
-  error = luaL_loadbuffer(s->L, data, len, "tag") ||  lua_pcall(s->L, 0, 0, 0);
+/*---------------------------------------------------------------------------*/
+/* Run the Lua block seg of the page s->tpl */
+static
+int http_run_elua (struct httpd_state *s, unsigned short seg)
+{
+  int error;
+  u32 t;
 
+  /* clean the elua output buffer */
+  s->write_buffer_len = 0;
+
+  if (s->new_pht_page || s->L == NULL) {
+    /* the connection keeps the state until the end of the answer */
+    if (s->L != NULL)
+      httpd_lua_release(s->L);
+    if ((s->L = http_session(s, s->new_pht_page)) == NULL) {
+      fprintf (stderr,"cannot get a Lua state from the pool\n");
+      return -1;
+    }
+    httpd_lua_hold(s->L);
+  }
+  s->new_pht_page = FALSE;
+
+  if(s->new_request) {
+    /* the parameters of the request, for all the blocks of the page */
+    httpd_url_push(s->L, &s->url, s->cacheable);
+    lua_setglobal(s->L, HTTP_PARAMS_TABLE);
+    s->new_request = FALSE;
+  }
+
+  lua_settop(s->L, 0);
+
+  /* the block runs in a coroutine, so that print() can yield */
+  http_end_elua(s);
+  s->co = lua_newthread(s->L);
+  s->co_ref = luaL_ref(s->L, LUA_REGISTRYINDEX);
+  httpd_lua_bind(s->co, s);
+
+  t = httpd_stats_clock();
+  error = httpd_tpl_push(s->co, s->tpl, seg);
+  s->t_load += httpd_stats_clock() - t;
   if (error)
   {
-    fprintf(stderr,"%s\n", lua_tostring(s->L, -1));
-   	lua_pop(s->L, 1);  /* pop error message from the stack */
+    fprintf(stderr,"%s\n", lua_tostring(s->co, -1));
+    http_end_elua(s);
+    return error;
+  }
+  http_resume_elua(s);
+
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+/* a request starts coming: measure it */
+static void
+http_stats_begin(struct httpd_state *s)
+{
+  s->timed = TRUE;
+  s->t_start = s->t_mark = httpd_stats_clock();
+  s->t_spent = s->t_load = s->t_exec = 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/* the phase that began at t_mark ends now */
+static void
+http_phase(struct httpd_state *s, int phase)
+{
+  u32 now = httpd_stats_clock();
+
+  if(s->timed) {
+    httpd_stats_hist(&httpd_stats()->phase[phase], now - s->t_mark);
+    s->t_spent += now - s->t_mark;
   }
+  s->t_mark = now;
+}
 
-  return error;
+/*---------------------------------------------------------------------------*/
+/* the request measured has been answered: what is left was sending */
+static void
+http_stats_end(struct httpd_state *s)
+{
+  struct httpd_stats *st = httpd_stats();
+  u32 total, other;
+
+  if(!s->timed) {
+    return;
+  }
+  s->timed = FALSE;
+  total = httpd_stats_clock() - s->t_start;
+  other = s->t_spent + s->t_load + s->t_exec;
+  if(s->t_load > 0) {
+    httpd_stats_hist(&st->phase[HTTPD_PHASE_LOAD], s->t_load);
+  }
+  if(s->t_exec > 0) {
+    httpd_stats_hist(&st->phase[HTTPD_PHASE_EXEC], s->t_exec);
+  }
+  httpd_stats_hist(&st->phase[HTTPD_PHASE_SEND], total > other ? total - other : 0);
+  httpd_stats_hist(s->route != NULL ? &s->route->hist : s->tpl != NULL ? &st->pages : &st->files, total);
+  if(s->status != NULL && s->status[9] >= '1' && s->status[9] <= '5') {
+    st->status[s->status[9] - '1']++;
+  }
+}
+
+/*---------------------------------------------------------------------------*/
+/* a new budget for the scripts of s */
+static void
+http_budget(struct httpd_state *s)
+{
+  s->slices = 0;
+  s->runtime = 0;
+  s->overrun = 0;
+}
+/*---------------------------------------------------------------------------*/
+/* Run the handler of a route, a Lua one in a coroutine of its own state
+   like the blocks of a page */
+static void
+http_run_route(struct httpd_state *s, struct httpd_route *route)
+{
+  u32 t;
+
+  s->write_buffer_len = 0;
+  http_budget(s);
+
+  if(route->fn != NULL) {
+    set_httpd_state_struct(s);
+    t = httpd_stats_clock();
+    route->fn(s);
+    s->t_exec += httpd_stats_clock() - t;
+    set_httpd_state_struct(NULL);
+    if(!route->stream)
+      httpd_url_free(&s->url);
+    return;
+  }
+
+  http_end_elua(s);
+  s->co = lua_newthread(route->L);
+  s->co_ref = luaL_ref(route->L, LUA_REGISTRYINDEX);
+  httpd_lua_bind(s->co, s);
+  lua_rawgeti(s->co, LUA_REGISTRYINDEX, route->ref);
+  if(s->ws != NULL) {
+    lua_pushlstring(s->co, s->ws->msg, s->ws->msglen);
+  } else {
+    httpd_url_push(s->co, &s->url, s->cacheable);
+  }
+  lua_pushstring(s->co, s->filename);
+  http_resume_elua(s);
 }
 /*---------------------------------------------------------------------------*/
 /** @} */
@@ -39,6 +39,13 @@
 #include "platform_conf.h"
 #include "psock.h"
 #include "httpd-fs.h"
+#include "httpd-tpl.h"
+#include "httpd-url.h"
+#include "httpd-ws.h"
+
+struct httpd_route;
+struct httpd_cache_entry;
+struct uip_conn;
 
 #ifdef WEB_SERVER_DEBUG
 #else
@@ -49,33 +56,131 @@
 #define WRITE_BUFFER_SIZE 1024
 #define HTTP_PARAMS_TABLE "reqdata"
 
+/* Room for the pipelined requests that arrive while answering */
+#ifndef HTTPD_PIPELINE_SIZE
+#define HTTPD_PIPELINE_SIZE 128
+#endif
+/* Milliseconds between two periodic polls of a connection */
+#ifndef HTTPD_POLL_MS
+#define HTTPD_POLL_MS 500
+#endif
+/* A connection waiting for a request is closed after this number of
+   periodic polls */
+#ifndef HTTPD_IDLE_TIMEOUT
+#define HTTPD_IDLE_TIMEOUT 10
+#endif
+/* Seconds a browser may use a static file before asking again if it
+   changed */
+#ifndef HTTPD_MAX_AGE
+#define HTTPD_MAX_AGE 600
+#endif
+
+/* An event stream that sent nothing for this number of polls sends a
+   comment line, a websocket a ping, so a client gone away is found by
+   the retransmissions */
+#ifndef HTTPD_SSE_KEEPALIVE
+#define HTTPD_SSE_KEEPALIVE 10
+#endif
+
+/* httpd_state.cond_type: the request is conditional */
+#define HTTPD_COND_NONE  0
+#define HTTPD_COND_ETAG  1  /* If-None-Match, cond holds the tags */
+#define HTTPD_COND_DATE  2  /* If-Modified-Since, cond holds the date */
+#define HTTPD_COND_RANGE 3  /* If-Range, cond holds a tag or a date */
+
+/* httpd_state.pendjson: the document of a json.write() ... */
+#define HTTPD_JSON_WRITING 1  /* ... is on the stack of co, sent as it is written */
+#define HTTPD_JSON_WRITTEN 2  /* ... is out, json.write() returns at the resume */
+
 struct httpd_state {
   unsigned char timer;
   struct psock sin, sout;
-  struct pt outputpt, scriptpt;
+  struct pt outputpt, scriptpt, luapt;
   char inputbuf[50];
-  char filename[20];
+  char filename[HTTPD_FS_NAME_LEN];
   char state;
+  char keepalive;
+  char http11;
+  char chunked;
+  char accept_gzip;       /* the client takes Content-Encoding: gzip */
+  char accept_cbor;       /* the client takes application/cbor */
+  char gzip;              /* the file sent is the .gz variant */
+  char vary;              /* a static file: a .gz variant may be sent */
+  long content_len;
+  char cond_type;
+  char cond[30];
+  char range;             /* a single byte range was asked */
+  char if_range;          /* ... only if the file did not change */
+  long range_first;       /* -1: the range_last last bytes */
+  long range_last;        /* -1: up to the end; both resolved when sent */
+  const char *status;     /* status line and Server header to send */
+  const char *content_type; /* Content-type line, NULL: from the extension */
+  time_t mtime;           /* validators of a static file, 0 if none */
+  long size;              /* whole size of a static file, else -1 */
   struct httpd_fs_file file;
+  struct httpd_tpl *tpl;
+  unsigned short tplseg;
   int len;
   char *scriptptr;
   int scriptlen;
   u16_t ripaddr[2];
   unsigned short count;
   lua_State *L;
+  lua_State *co;          /* coroutine running the current Lua block */
+  int co_ref;
+  const char *pending;    /* print() text not yet in write_buffer */
+  size_t pendlen;
+  char pendraw;           /* pending keeps its newlines (an event) */
+  char pendjson;          /* HTTPD_JSON_*: json.write() yielded */
+  const char *jsonerr;    /* why its document was cut, NULL if it was not */
+  char stream;            /* text/event-stream: open until the handler ends */
+  unsigned short sleep;   /* polls before the handler is resumed */
+  char runnable;          /* the handler gave the CPU back, it goes on */
+  unsigned short slices;  /* budget of the scripts: instructions / HTTPD_LUA_SLICE */
+  unsigned short runtime; /* and polls running */
+  char overrun;           /* HTTPD_LUA_OVER_*: the scripts were aborted */
+  char timed;             /* the durations of the request are measured */
+  unsigned long t_start;  /* httpd_stats_clock() when the request came */
+  unsigned long t_mark;   /* start of the phase being measured */
+  unsigned long t_spent;  /* in the phases measured so far */
+  unsigned long t_load;   /* splitting and compiling, all blocks together */
+  unsigned long t_exec;   /* in the handlers */
+  unsigned short write_hwm; /* high-water marks of the connection */
+  unsigned short heap_hwm;  /* KB of its Lua states */
+  char post;              /* the method is POST */
+  char cacheable;         /* the response can be kept, the parameters are its key */
+  struct httpd_cache_entry *cached; /* response replayed from the cache */
+  unsigned long cache_ttl;  /* ms: httpd.cache() asks to keep the response */
+  struct httpd_route *route;
+  unsigned long cursor;   /* free for the C handler of an event stream */
+  char upgrade;           /* Upgrade: websocket */
+  struct httpd_ws *ws;    /* the connection is, or asks to be, a websocket */
   int  http_connection_nr;
   char new_pht_page;
-  char http_params[30];
+  struct httpd_url url;   /* decoder of the target and of a form */
+  long body_left;         /* bytes of the request body still to come */
+  char form;              /* the body is application/x-www-form-urlencoded */
+  char expect_continue;   /* the client waits for 100 Continue */
+  char new_request;       /* reqdata has not been set for this request */
   char write_buffer[WRITE_BUFFER_SIZE];
   _ssize_t write_buffer_len;
+  char pipebuf[HTTPD_PIPELINE_SIZE];
+  unsigned short pipelen;
 
 };
 
 struct httpd_state *get_httpd_state_struct(void);
+void               httpd_init(void);
 void               httpd_appcall(void);
+int                httpd_resume(struct uip_conn *);
 void               httpd_uip_mainloop(void );
 void               http_uip_init( const struct uip_eth_addr *);
 _ssize_t           http_send_str(const char *, _ssize_t);
+_ssize_t           http_buffer_str(struct httpd_state *, const char *, _ssize_t);
+_ssize_t           http_buffer_data(struct httpd_state *, const char *, _ssize_t);
+int                http_buffer_json(struct httpd_state *, lua_State *, const char **);
+size_t             http_sse_frame(char *, const char *, const char *, size_t);
+int                http_sse_send(struct httpd_state *, const char *, const char *, size_t);
 _ssize_t           http_uart_send_str(const char *, _ssize_t);
 
 #endif /* __HTTPD_H__ */
@@ -0,0 +1,532 @@
+#include "platform_conf.h"
+#ifdef BUILD_WEB_SERVER
+
+#include <lua.h>
+#include <lauxlib.h>
+#include <lualib.h>
+#include "luajson_lib.h"
+#include "luacbor_lib.h"
+#include "type.h"
+
+#include <string.h>
+#include <math.h>
+
+// CBOR (RFC 7049), the binary twin of the json module: the same values,
+// with the numbers in binary. An integer takes 1 to 9 bytes, a number
+// with a fraction the shortest float that holds it exactly (2, 4 or 8
+// bytes), and none of them goes through text.
+
+#define CBOR_UINT 0         // major types
+#define CBOR_NEGINT 1
+#define CBOR_BYTES 2
+#define CBOR_TEXT 3
+#define CBOR_ARRAY 4
+#define CBOR_MAP 5
+#define CBOR_TAG 6
+#define CBOR_SIMPLE 7
+
+#define CBOR_FALSE 0xf4
+#define CBOR_TRUE 0xf5
+#define CBOR_NULL 0xf6
+#define CBOR_UNDEFINED 0xf7
+#define CBOR_HALF 0xf9
+#define CBOR_FLOAT 0xfa
+#define CBOR_DOUBLE 0xfb
+#define CBOR_BREAK 0xff
+
+#define CBOR_INDEFINITE 31  // additional information of the indefinite lengths
+
+// ~~~ ENCODE ~~~
+
+// The walk of the tables is the one of json.write (luajson_lib.c), with
+// the arrays and maps of indefinite length: their size is not known before
+// they are written, and a document can go out a piece at a time.
+
+/// A head: the major type and its argument in the fewest bytes.
+static int cborPutHead(JSONOut *o, int major, u64 v)
+{
+    int n, i;
+
+    if (v < 24)
+        n = 0;
+    else if (v < 0x100)
+        n = 1;
+    else if (v < 0x10000)
+        n = 2;
+    else if (v < 0x100000000ULL)
+        n = 4;
+    else
+        n = 8;
+    if (o->end - o->p < n + 1)
+        return 0;
+    if (n == 0)
+    {
+        *o->p++ = (char)(major << 5 | (int)v);
+        return 1;
+    }
+    *o->p++ = (char)(major << 5 | (n == 1 ? 24 : n == 2 ? 25 : n == 4 ? 26 : 27));
+    for (i = n - 1; i >= 0; i--)
+        *o->p++ = (char)(v >> (8 * i));
+    return 1;
+}
+
+/// A simple value or a float: the byte of its type then n bytes of bits.
+static int cborPutBits(JSONOut *o, int type, u64 bits, int n)
+{
+    if (o->end - o->p < n + 1)
+        return 0;
+    *o->p++ = (char)type;
+    while (n-- > 0)
+        *o->p++ = (char)(bits >> (8 * n));
+    return 1;
+}
+
+#if !defined LUA_NUMBER_INTEGRAL
+
+/// The half float of f, if it holds f exactly. NaN is the canonical one.
+static int cborHalf(float f, unsigned *h)
+{
+    u32 bits;
+    unsigned sign, m;
+    int e, shift;
+
+    if (f != f)
+    {
+        *h = 0x7e00;
+        return 1;
+    }
+    memcpy(&bits, &f, 4);
+    sign = (bits >> 16) & 0x8000;
+    e = (int)((bits >> 23) & 0xff) - 127;
+    m = bits & 0x7fffff;
+    if (e == -127 && m == 0)
+        *h = sign;
+    else if (e == 128)
+        *h = sign | 0x7c00;
+    else if (e >= -14 && e <= 15 && (m & 0x1fff) == 0)
+        *h = sign | (e + 15) << 10 | m >> 13;
+    else if (e >= -24 && e < -14)
+    {
+        // a subnormal half: the mantissa, its leading 1 included, shifted
+        m |= 0x800000;
+        shift = -1 - e;
+        if (m & ((1UL << shift) - 1))
+            return 0;
+        *h = sign | m >> shift;
+    }
+    else
+        return 0;
+    return 1;
+}
+
+/// A number with a fraction, or too big for an integer.
+static int cborPutFloat(JSONOut *o, double d)
+{
+    float f = (float)d;
+    u32 bits;
+    u64 dbits;
+    unsigned h;
+
+    if (f == d || d != d)
+    {
+        if (cborHalf(f, &h))
+            return cborPutBits(o, CBOR_HALF, h, 2);
+        memcpy(&bits, &f, 4);
+        return cborPutBits(o, CBOR_FLOAT, bits, 4);
+    }
+    memcpy(&dbits, &d, 8);
+    return cborPutBits(o, CBOR_DOUBLE, dbits, 8);
+}
+
+#endif
+
+static int cborPutNumber(JSONOut *o, lua_Number n)
+{
+#if !defined LUA_NUMBER_INTEGRAL
+    // exact integers only: beyond 2^53 a float is as short
+    if (n != floor(n) || n < -9007199254740992.0 || n > 9007199254740992.0)
+        return cborPutFloat(o, n);
+#endif
+    if (n >= 0)
+        return cborPutHead(o, CBOR_UINT, (u64)n);
+    return cborPutHead(o, CBOR_NEGINT, (u64)(-(n + 1)));
+}
+
+/// Is s valid UTF-8? Else it goes as a byte string.
+static int cborText(const unsigned char *s, size_t len)
+{
+    const unsigned char *end = s + len;
+    int n;
+
+    while (s < end)
+    {
+        if (*s < 0x80)
+        {
+            s++;
+            continue;
+        }
+        if (*s >= 0xc2 && *s <= 0xdf)
+            n = 1;
+        else if (*s >= 0xe0 && *s <= 0xef)
+            n = 2;
+        else if (*s >= 0xf0 && *s <= 0xf4)
+            n = 3;
+        else
+            return 0;
+        if (end - s <= n)
+            return 0;
+        for (s++; n > 0; n--, s++)
+        {
+            if ((*s & 0xc0) != 0x80)
+                return 0;
+        }
+    }
+    return 1;
+}
+
+/// Writes what fits of a string, from W->off on: the head first, whole,
+/// then its bytes. Returns 1 once they are all out.
+static int cborPutString(JSONWriter *W, JSONOut *o, const char *s, size_t len)
+{
+    size_t n;
+
+    if (W->off == 0)
+    {
+        if (!cborPutHead(o, cborText((const unsigned char *)s, len) ? CBOR_TEXT : CBOR_BYTES, len))
+            return 0;
+        W->off = 1;
+    }
+    n = len - (W->off - 1);
+    if (n > (size_t)(o->end - o->p))
+        n = o->end - o->p;
+    memcpy(o->p, s + W->off - 1, n);
+    o->p += n;
+    W->off += n;
+    if (W->off - 1 < len)
+        return 0;
+    W->off = 0;
+    return 1;
+}
+
+/// The scalars of CBOR: a key is written like any other value.
+static int cborScalar(JSONWriter *W, lua_State *L, int idx, JSONOut *o, int key)
+{
+    size_t len;
+    const char *s;
+
+    switch (lua_type(L, idx))
+    {
+    case LUA_TBOOLEAN:
+        return cborPutBits(o, lua_toboolean(L, idx) ? CBOR_TRUE : CBOR_FALSE, 0, 0);
+    case LUA_TNUMBER:
+        return cborPutNumber(o, lua_tonumber(L, idx));
+    case LUA_TSTRING:
+        s = lua_tolstring(L, idx, &len);
+        return cborPutString(W, o, s, len);
+    default:
+        return cborPutBits(o, CBOR_NULL, 0, 0);
+    }
+}
+
+const JSONFormat CBOR_format =
+{
+    (char)(CBOR_ARRAY << 5 | CBOR_INDEFINITE), (char)CBOR_BREAK,
+    (char)(CBOR_MAP << 5 | CBOR_INDEFINITE), (char)CBOR_BREAK,
+    0, 0, cborScalar
+};
+
+#define CBOR_PIECES 2       // stack slot of the table of full buffers
+#define CBOR_WRITER 3
+
+static int CBOR_encode(lua_State *L)
+{
+    char buf[LUAL_BUFFERSIZE];
+    size_t len;
+    const char *err;
+    int npieces = 0, i;
+
+    lua_settop(L, 1);
+    lua_pushnil(L);     // CBOR_PIECES
+    lua_pushvalue(L, 1);
+    JSON_write_begin(L, &CBOR_format);
+    while (!JSON_write_step(L, CBOR_WRITER, buf, sizeof(buf), &len, &err))
+    {
+        if (npieces == 0)
+        {
+            lua_newtable(L);
+            lua_replace(L, CBOR_PIECES);
+        }
+        lua_pushlstring(L, buf, len);
+        lua_rawseti(L, CBOR_PIECES, ++npieces);
+    }
+    if (err != NULL)
+        return luaL_error(L, "cbor.encode: %s", err);
+    luaL_checkstack(L, npieces + 1, "cbor.encode: document too big");
+    for (i = 1; i <= npieces; i++)
+        lua_rawgeti(L, CBOR_PIECES, i);
+    lua_pushlstring(L, buf, len);
+    lua_concat(L, npieces + 1);
+    return 1;
+}
+
+// ~~~ DECODE ~~~
+
+// A recursive descent over the bytes, bounded by JSON_MAX_DEPTH like
+// json.parse. The tags are skipped, null and undefined give json.null,
+// the other simple values are an error.
+
+typedef struct
+{
+    lua_State *L;
+    const unsigned char *data;
+    const unsigned char *end;
+    const unsigned char *p;     // the item being read
+    int depth;
+} CBORReader;
+
+static void cborError(CBORReader *R, const char *what)
+{
+    if (R->p >= R->end)
+        luaL_error(R->L, "cbor.decode: %s at the end", what);
+    else
+        luaL_error(R->L, "cbor.decode: %s at byte %d", what, (int)(R->p - R->data) + 1);
+}
+
+/// Reads the head at R->p: its major type, and its argument in *v.
+/// Returns 1 for an indefinite length (or a break).
+static int cborReadHead(CBORReader *R, int *major, u64 *v)
+{
+    int info, n;
+
+    if (R->p >= R->end)
+        cborError(R, "data missing");
+    *major = *R->p >> 5;
+    info = *R->p & 0x1f;
+    if (info < 24)
+    {
+        *v = info;
+        R->p++;
+        return 0;
+    }
+    if (info == CBOR_INDEFINITE)
+    {
+        if (*major < CBOR_BYTES || *major == CBOR_TAG)
+            cborError(R, "bad indefinite length");
+        R->p++;
+        return 1;
+    }
+    if (info > 27)
+        cborError(R, "reserved value");
+    n = 1 << (info - 24);
+    if (R->end - R->p < n + 1)
+    {
+        R->p = R->end;
+        cborError(R, "data missing");
+    }
+    for (*v = 0, R->p++; n > 0; n--)
+        *v = *v << 8 | *R->p++;
+    return 0;
+}
+
+/// The string of length len at R->p, added to B or pushed.
+static void cborReadBytes(CBORReader *R, u64 len, luaL_Buffer *B)
+{
+    if (len > (u64)(R->end - R->p))
+    {
+        R->p = R->end;
+        cborError(R, "data missing");
+    }
+    if (B != NULL)
+        luaL_addlstring(B, (const char *)R->p, (size_t)len);
+    else
+        lua_pushlstring(R->L, (const char *)R->p, (size_t)len);
+    R->p += len;
+}
+
+/// Is the break of an indefinite length at R->p? It is passed.
+static int cborBreak(CBORReader *R)
+{
+    if (R->p >= R->end)
+        cborError(R, "data missing");
+    if (*R->p != CBOR_BREAK)
+        return 0;
+    R->p++;
+    return 1;
+}
+
+#if !defined LUA_NUMBER_INTEGRAL
+
+static lua_Number cborHalfValue(unsigned h)
+{
+    int e = (h >> 10) & 0x1f;
+    double d;
+
+    if (e == 0)
+        d = ldexp(h & 0x3ff, -24);
+    else if (e == 31)
+        d = (h & 0x3ff) ? NAN : HUGE_VAL;
+    else
+        d = ldexp((h & 0x3ff) | 0x400, e - 25);
+    return (h & 0x8000) ? -d : d;
+}
+
+#endif
+
+static void cborReadValue(CBORReader *R);
+
+static void cborReadTable(CBORReader *R, int major, u64 n, int indefinite)
+{
+    lua_State *L = R->L;
+    u64 i;
+    int size;
+
+    if (++R->depth > JSON_MAX_DEPTH)
+        cborError(R, "tables nested too deep");
+    luaL_checkstack(L, 3, "cbor.decode: tables nested too deep");
+    // each element takes a byte at least: a wrong count does not reserve
+    size = indefinite || n > (u64)(R->end - R->p) ? 0 : (int)n;
+    if (major == CBOR_ARRAY)
+    {
+        lua_createtable(L, size, 0);
+        for (i = 1; indefinite ? !cborBreak(R) : i <= n; i++)
+        {
+            cborReadValue(R);
+            lua_rawseti(L, -2, (int)i);
+        }
+    }
+    else
+    {
+        lua_createtable(L, 0, size);
+        for (i = 1; indefinite ? !cborBreak(R) : i <= n; i++)
+        {
+            cborReadValue(R);
+            if (lua_type(L, -1) == LUA_TNUMBER && lua_tonumber(L, -1) != lua_tonumber(L, -1))
+                cborError(R, "NaN key");
+            cborReadValue(R);
+            lua_rawset(L, -3);
+        }
+    }
+    R->depth--;
+}
+
+static void cborReadValue(CBORReader *R)
+{
+    lua_State *L = R->L;
+    const unsigned char *start = R->p;
+    luaL_Buffer B;
+    u64 v;
+    int major, chunk, indefinite;
+
+    indefinite = cborReadHead(R, &major, &v);
+    switch (major)
+    {
+    case CBOR_UINT:
+        lua_pushnumber(L, (lua_Number)v);
+        break;
+    case CBOR_NEGINT:
+        lua_pushnumber(L, -1 - (lua_Number)v);
+        break;
+    case CBOR_BYTES:
+    case CBOR_TEXT:
+        if (!indefinite)
+        {
+            cborReadBytes(R, v, NULL);
+            break;
+        }
+        // chunks of definite length, of the same type
+        luaL_buffinit(L, &B);
+        while (!cborBreak(R))
+        {
+            start = R->p;
+            if (cborReadHead(R, &chunk, &v) || chunk != major)
+            {
+                R->p = start;
+                cborError(R, "bad string chunk");
+            }
+            cborReadBytes(R, v, &B);
+        }
+        luaL_pushresult(&B);
+        break;
+    case CBOR_ARRAY:
+    case CBOR_MAP:
+        cborReadTable(R, major, v, indefinite);
+        break;
+    case CBOR_TAG:
+        if (++R->depth > JSON_MAX_DEPTH)
+            cborError(R, "tags nested too deep");
+        cborReadValue(R);
+        R->depth--;
+        break;
+    default:
+        switch (*start)
+        {
+        case CBOR_FALSE:
+        case CBOR_TRUE:
+            lua_pushboolean(L, *start == CBOR_TRUE);
+            break;
+        case CBOR_NULL:
+        case CBOR_UNDEFINED:
+            lua_pushlightuserdata(L, NULL);
+            break;
+#if !defined LUA_NUMBER_INTEGRAL
+        case CBOR_HALF:
+            lua_pushnumber(L, cborHalfValue((unsigned)v));
+            break;
+        case CBOR_FLOAT:
+        {
+            u32 bits = (u32)v;
+            float f;
+
+            memcpy(&f, &bits, 4);
+            lua_pushnumber(L, f);
+            break;
+        }
+        case CBOR_DOUBLE:
+        {
+            double d;
+
+            memcpy(&d, &v, 8);
+            lua_pushnumber(L, d);
+            break;
+        }
+#endif
+        default:
+            R->p = start;
+            cborError(R, indefinite ? "unexpected break" : "unsupported simple value");
+        }
+    }
+}
+
+static int CBOR_decode(lua_State *L)
+{
+    CBORReader R;
+    size_t len;
+
+    R.L = L;
+    R.data = (const unsigned char *)luaL_checklstring(L, 1, &len);
+    R.end = R.data + len;
+    R.p = R.data;
+    R.depth = 0;
+    cborReadValue(&R);
+    if (R.p != R.end)
+        cborError(&R, "data after the value");
+    return 1;
+}
+
+// Module function map
+#define MIN_OPT_LEVEL 2
+#include "lrodefs.h"
+const LUA_REG_TYPE cbor_map[] =
+{
+  { LSTRKEY( "encode" ), LFUNCVAL( CBOR_encode ) },
+  { LSTRKEY( "decode" ), LFUNCVAL( CBOR_decode ) },
+  { LNILKEY, LNILVAL }
+};
+
+LUALIB_API int luaopen_cbor( lua_State *L )
+{
+  luaL_register( L, AUXLIB_CBOR, cbor_map );
+  return 1;
+}
+
+#endif
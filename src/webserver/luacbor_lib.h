@@ -0,0 +1,9 @@
+#ifndef __LUACBOR_LIB_H__
+#define __LUACBOR_LIB_H__
+
+#include "luajson_lib.h"
+
+/* The values in CBOR, for JSON_write_begin() */
+extern const JSONFormat CBOR_format;
+
+#endif /* __LUACBOR_LIB_H__ */
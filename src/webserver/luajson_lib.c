@@ -4,6 +4,7 @@
 #include <lua.h>
 #include <lauxlib.h>
 #include <lualib.h>
+#include "luajson_lib.h"
 
 #include <stdio.h>
 #include <string.h>
@@ -11,924 +12,923 @@
 #include <stdlib.h>
 #include <math.h>
 
-static const char ESC=27;
-static const char OPN=28;
-static const char CLS=29;
+// ~~~ PARSE ~~~
 
-//--- auxliary functions -------------------------------------------
-/*
-static void stackDump (lua_State *L)
-{
-    int i;
-    int top = lua_gettop(L);
-    for (i = 1; i <= top; i++)
-    {  // repeat for each level
-        int t = lua_type(L, i);
-        switch (t) {
-        case LUA_TSTRING:  // strings
-            printf("`%s'", lua_tostring(L, i));
-            break;
-        case LUA_TBOOLEAN:  // booleans
-            printf(lua_toboolean(L, i) ? "true" : "false");
-            break;
-        case LUA_TNUMBER:  // numbers
-            printf("%g", lua_tonumber(L, i));
-            break;
-        default:  // other values
-            printf("%s", lua_typename(L, t));
-            break;
-        }
-        printf("  ");  // put a separator
-    }
-    printf("\n");  // end the listing
-}
-//*/
+// A recursive descent over the text, which is not copied: a string without
+// escapes is pushed straight from it, one with escapes is decoded in place
+// when the text may be written, else in a luaL_Buffer. The text ends with
+// a '\0', so the scans stop on it. Each table is created with the number
+// of its elements, counted before they are read. The keys are interned by
+// lua_pushlstring: a key seen before is found, not allocated again.
 
-void JSONError(lua_State *L, const char* msg)
+typedef struct
 {
-    // what
-    lua_pushlstring(L, msg, strlen(msg));
-    lua_error(L);
-}
+    lua_State *L;
+    const char *text;
+    const char *end;        // the '\0' after the text
+    const char *p;
+    int inplace;            // the text may be written
+    int depth;
+} JSONReader;
 
-void JSONDebug(lua_State *L, const char* msg)
+static void jsonParseError(JSONReader *R, const char *what)
 {
-    lua_getglobal(L, "print");
-    lua_pushlstring(L, msg, strlen(msg));
-    lua_call(L, 1, 0);
-}
-
-unsigned int digit2int(lua_State *L, const unsigned char digit)
-{
-    unsigned int val;
-    if (digit >= '0' && digit <= '9')
-        val = digit - '0';
-    else if (digit >= 'a' || digit <= 'f')
-        val = digit - 'a' + 10;
-    else if (digit >= 'A' || digit <= 'F')
-        val = digit - 'A' + 10;
+    if (R->p == R->end)
+        luaL_error(R->L, "json.parse: %s at the end", what);
     else
-        JSONError(L, "Invalid hex digit");
-    return val;
+        luaL_error(R->L, "json.parse: %s at byte %d", what, (int)(R->p - R->text) + 1);
 }
 
-unsigned int fourhex2int(lua_State *L, const char * code)
+static void jsonSkipSpace(JSONReader *R)
 {
-    unsigned int utf = 0;
-    utf += digit2int(L, code[0]) * 4096;
-    utf += digit2int(L, code[1]) * 256;
-    utf += digit2int(L, code[2]) * 16;
-    utf += digit2int(L, code[3]);
-    return utf;
-}
-#ifdef JSON_PARSE
-static const char* code2utf8(lua_State *L, const  char * code, char buf[4])
-{
-    unsigned int utf = 0;
-    utf = fourhex2int(L, code);
-    if (utf < 128)
-    {
-        buf[0] = utf & 0x7F;
-        buf[1] = 0;
-        buf[2] = 0;
-        buf[3] = 0;
-        return buf;
-    }
-    else if (utf < 2048)
-    {
-        buf[0] = ((utf >> 6) & 0x1F) | 0xC0;
-        buf[1] = (utf & 0x3F) | 0x80;
-        buf[2] = 0;
-        buf[3] = 0;
-        return buf;
-    }
-    else
-    {
-        buf[0] = ((utf >> 12) & 0x0F) | 0xE0;
-        buf[1] = ((utf >> 6) & 0x3F) | 0x80;
-        buf[2] = (utf & 0x3F) | 0x80;
-        buf[3] = 0;
-        return buf;
-    }
-    return buf;
+    while (*R->p == ' ' || *R->p == '\t' || *R->p == '\n' || *R->p == '\r')
+        R->p++;
 }
 
-void passwhitespace(lua_State *L, char ** c)
+/// The number of elements of the array or object that starts at R->p,
+/// after its bracket: a size hint, a broken text is found when it is read.
+static int jsonCount(JSONReader *R, char close)
 {
-    while (**c == ' ' || **c == '\r' || **c == '\n' || **c == '\t')
-    {
-        (*c)++;
-    }
-}
-
-
-void readValue(lua_State *L, char * str, char ** c);
-void readString(lua_State *L, char * str, char ** c);
+    const char *p = R->p;
+    int depth = 0, n = 1;
 
-void readArray(lua_State *L, char * str, char ** c)
-{
-    if (**c != '[')
-        JSONError(L, "JSON readArray (1) b0rked :c.");
-    //JSONError(L, strcat(*c, "JSON readArray b0rked :c."));
-    (*c)++;
-    int i = 1;
-    lua_newtable(L);
-    for (i = 1; 1; i++)
+    if (*p == close)
+        return 0;
+    for (; *p; p++)
     {
-        passwhitespace(L, c);
-        lua_pushinteger(L, i);
-        //JSONError(L, ": hmm...");
-        readValue(L, str, c);
-        lua_settable(L, -3);
-        passwhitespace(L, c);
-        if (**c == ',')
+        switch (*p)
         {
-            (*c)++;
-            passwhitespace(L, c);
-        }
-        else
+        case '"':
+            for (p++; *p && *p != '"'; p++)
+            {
+                if (*p == '\\' && p[1])
+                    p++;
+            }
+            if (!*p)
+                return n;
+            break;
+        case '[':
+        case '{':
+            depth++;
+            break;
+        case ']':
+        case '}':
+            if (depth-- == 0)
+                return n;
             break;
+        case ',':
+            if (depth == 0)
+                n++;
+            break;
+        }
     }
-    passwhitespace(L, c);
-    if (**c == ']')
-        (*c)++;
-    else
-        JSONError(L, strcat(*c, "JSON readArray b0rked :c."));
+    return n;
 }
 
-void readFalse(lua_State *L, char * str, char ** c)
+static int jsonHex(char c)
 {
-    if (!strncmp(*c, "false", 5))
-    {
-        lua_pushboolean(L, 0);
-        *c += 5;
-    }
-    else
-        JSONError(L, "JSON readFalse b0rked :c.");
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
 }
 
-void readNull(lua_State *L, char * str, char ** c)
+/// The code of the \uXXXX at R->p, which is passed.
+static unsigned long jsonReadCode(JSONReader *R)
 {
-    if (!strncmp(*c, "null", 4))
+    unsigned long code = 0;
+    int i, d;
+
+    for (i = 2; i < 6; i++)
     {
-        lua_getglobal(L, "json");
-        lua_getfield(L, -1, "null");
-        lua_remove(L, -2);
-        *c += 4;
+        if ((d = jsonHex(R->p[i])) < 0)
+            jsonParseError(R, "bad \\u escape");
+        code = (code << 4) | d;
     }
-    else
-        JSONError(L, "JSON readNull b0rked :c.");
+    R->p += 6;
+    return code;
 }
 
-void readNumber(lua_State *L, char * str, char ** c)
+/// Decodes the escape at R->p in out, returns its length.
+static size_t jsonReadEscape(JSONReader *R, char out[4])
 {
-    float neg;
-    if (**c == '-')
+    unsigned long code, low;
+
+    switch (R->p[1])
     {
-        neg = -1;
-        (*c)++;
-    }
-    else
-        neg = 1;
-    double num = 0;
-    char * save;
-    save = *c;
-    char * foundDec = NULL, * foundExp = NULL, * foundEnd = NULL;
-    while (foundEnd == NULL)
-    {
-        switch (**c)
+    case '"':  out[0] = '"'; break;
+    case '\\': out[0] = '\\'; break;
+    case '/':  out[0] = '/'; break;
+    case 'b':  out[0] = '\b'; break;
+    case 'f':  out[0] = '\f'; break;
+    case 'n':  out[0] = '\n'; break;
+    case 'r':  out[0] = '\r'; break;
+    case 't':  out[0] = '\t'; break;
+    case 'u':
+        code = jsonReadCode(R);
+        if (code >= 0xD800 && code < 0xDC00 && R->p[0] == '\\' && R->p[1] == 'u')
         {
-        case '0':
-        case '1':
-        case '2':
-        case '3':
-        case '4':
-        case '5':
-        case '6':
-        case '7':
-        case '8':
-        case '9':
-            break;
-        case '.':
-            if (foundDec != NULL || foundExp != NULL)
-                JSONError(L, "bad number format");
-            foundDec = *c;
-            break;
-        case 'e':
-        case 'E':
-            if (foundExp != NULL)
-                JSONError(L, "bad number format");
-            foundExp = *c;
-            break;
-        case '-':
-        case '+':
-            //if (*((*c)-1) != 'e' || *((*c)-1) != 'E')
-                //JSONError(L, "bad number format");
-            break;
-        default:
-            foundEnd = *c;
-            break;
+            // a surrogate pair: one character past 0xFFFF
+            low = jsonReadCode(R);
+            if (low < 0xDC00 || low >= 0xE000)
+                jsonParseError(R, "bad surrogate pair");
+            code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
         }
-        (*c)++;
-    }
-    *c = save;
-    int exp;
-    double exponent = 0;
-    int exponentneg = 1;
-    if (foundDec != NULL)
-    {
-        exp = foundDec - *c - 1;
-        for (; **c != '.'; exp--)
+        if (code < 0x80)
         {
-            num += (**c - '0') * pow(10, exp);
-            (*c)++;
+            out[0] = (char)code;
+            return 1;
         }
-        (*c)++;
-        if (foundExp != NULL)
+        if (code < 0x800)
         {
-            for (; **c != 'e' && **c != 'E'; exp--)
-            {
-                num += (**c - '0') * pow(10, exp);
-                (*c)++;
-            }
-            (*c)++;
-            if (**c == '-')
-            {
-                exponentneg = -1;
-                (*c)++;
-            }
-            else if (**c == '+')
-            {
-                (*c)++;
-            }
-            exp = foundEnd - *c - 1;
-            for (; *c != foundEnd; exp--)
-            {
-                exponent += (**c - '0') * pow(10, exp);
-                (*c)++;
-            }
+            out[0] = (char)(0xC0 | (code >> 6));
+            out[1] = (char)(0x80 | (code & 0x3F));
+            return 2;
         }
-        else
+        if (code < 0x10000)
         {
-            for (; *c != foundEnd; exp--)
-            {
-                num += (**c - '0') * pow(10, exp);
-                (*c)++;
-            }
+            out[0] = (char)(0xE0 | (code >> 12));
+            out[1] = (char)(0x80 | ((code >> 6) & 0x3F));
+            out[2] = (char)(0x80 | (code & 0x3F));
+            return 3;
         }
+        out[0] = (char)(0xF0 | (code >> 18));
+        out[1] = (char)(0x80 | ((code >> 12) & 0x3F));
+        out[2] = (char)(0x80 | ((code >> 6) & 0x3F));
+        out[3] = (char)(0x80 | (code & 0x3F));
+        return 4;
+    default:
+        jsonParseError(R, "bad escape");
     }
-    else if (foundExp != NULL)
+    R->p += 2;
+    return 1;
+}
+
+/// Pushes the string at R->p.
+static void jsonReadString(JSONReader *R)
+{
+    const char *start = ++R->p;
+    char *w;
+    char esc[4];
+    size_t n;
+    luaL_Buffer b;
+
+    while ((unsigned char)*R->p >= 32 && *R->p != '"' && *R->p != '\\')
+        R->p++;
+    if (*R->p == '"')
     {
-        exp = foundExp - *c - 1;
-        for (; **c != 'e' && **c != 'E'; exp--)
-        {
-            num += (**c - '0') * pow(10, exp);
-            (*c)++;
-        }
-        (*c)++;
-        if (**c == '-')
-        {
-            exponentneg = -1;
-            (*c)++;
-        }
-        else if (**c == '+')
-        {
-            (*c)++;
-        }
-        exp = foundEnd - *c - 1;
-        for (; *c != foundEnd; exp--)
+        lua_pushlstring(R->L, start, R->p++ - start);
+        return;
+    }
+    if (R->inplace)
+    {
+        // the decoded text is never longer: it is written over the escapes
+        w = (char *)R->p;
+        for (;;)
         {
-            exponent += (**c - '0') * pow(10, exp);
-            (*c)++;
+            if (*R->p == '"')
+                break;
+            if (*R->p == '\\')
+            {
+                n = jsonReadEscape(R, esc);
+                memcpy(w, esc, n);
+                w += n;
+            }
+            else if ((unsigned char)*R->p < 32)
+                jsonParseError(R, R->p == R->end ? "unfinished string" : "control character in string");
+            else
+                *w++ = *R->p++;
         }
+        lua_pushlstring(R->L, start, w - start);
+        R->p++;
+        return;
     }
-    else
+    luaL_buffinit(R->L, &b);
+    luaL_addlstring(&b, start, R->p - start);
+    for (;;)
     {
-        exp = foundEnd - *c - 1;
-        for (; exp >= 0; exp--)
+        if (*R->p == '"')
+            break;
+        if (*R->p == '\\')
         {
-            num += (**c - '0') * pow(10, exp);
-            (*c)++;
+            n = jsonReadEscape(R, esc);
+            luaL_addlstring(&b, esc, n);
         }
+        else if ((unsigned char)*R->p < 32)
+            jsonParseError(R, R->p == R->end ? "unfinished string" : "control character in string");
+        else
+            luaL_addchar(&b, *R->p++);
     }
-    num = neg * num * pow(10, exponentneg * exponent);
-    lua_pushnumber(L, num);
+    luaL_pushresult(&b);
+    R->p++;
 }
 
-void readObject(lua_State *L, char * str, char ** c)
+static int jsonDigits(JSONReader *R)
 {
-    if (**c != '{')
-        JSONError(L, "JSON readObject(1) b0rked :c.");
-    (*c)++;
-    lua_newtable(L);
-    while (1)
+    const char *start = R->p;
+
+    while (*R->p >= '0' && *R->p <= '9')
+        R->p++;
+    return R->p - start;
+}
+
+/// Pushes the number at R->p, checked against the JSON grammar first.
+/// Integers of up to 9 digits are converted here, the others by
+/// lua_str2number.
+static void jsonReadNumber(JSONReader *R)
+{
+    const char *start = R->p;
+    const char *digits;
+    int n, simple, bad = 0;
+    long v = 0;
+    char *end;
+
+    if (*R->p == '-')
+        R->p++;
+    digits = R->p;
+    n = jsonDigits(R);
+    bad = n == 0 || (*digits == '0' && n > 1);
+    simple = n <= 9;
+    if (*R->p == '.')
     {
-        passwhitespace(L, c);
-        readString(L, str, c);
-        passwhitespace(L, c);
-        if (**c != ':')
-        {
-            JSONError(L, "JSON readObject(2) b0rked :c.");
-        }
-        (*c)++;
-        passwhitespace(L, c);
-        readValue(L, str, c);
-        lua_settable(L, -3);
-        passwhitespace(L, c);
-        if (**c == ',')
-        {
-            (*c)++;
-            passwhitespace(L, c);
-        }
-        else
-            break;
+        R->p++;
+        bad |= jsonDigits(R) == 0;
+        simple = 0;
     }
-    passwhitespace(L, c);
-    if (**c == '}')
-        (*c)++;
-    else
-        JSONError(L, strcat(*c, "JSON readObject(3) b0rked :c."));
+    if (*R->p == 'e' || *R->p == 'E')
+    {
+        R->p++;
+        if (*R->p == '+' || *R->p == '-')
+            R->p++;
+        bad |= jsonDigits(R) == 0;
+        simple = 0;
+    }
+    if (bad)
+    {
+        R->p = start;
+        jsonParseError(R, "bad number");
+    }
+    if (simple)
+    {
+        for (; digits < R->p; digits++)
+            v = v * 10 + (*digits - '0');
+        lua_pushnumber(R->L, *start == '-' ? -v : v);
+        return;
+    }
+    lua_pushnumber(R->L, lua_str2number(start, &end));
 }
 
-void readString(lua_State *L, char * str, char ** c)
+static void jsonReadValue(JSONReader *R);
+
+/// Pushes the array or the object at R->p.
+static void jsonReadTable(JSONReader *R)
 {
-    if (**c != '"')
-        JSONError(L, "no string :c");
-    (*c)++;
-    int minus = 0;
-    char * beginning = *c;
-    char * end = NULL;
-    unsigned int utf;
-    while (end == NULL)
+    lua_State *L = R->L;
+    char close = *R->p == '[' ? ']' : '}';
+    int i;
+
+    if (++R->depth > JSON_MAX_DEPTH)
+        jsonParseError(R, "tables nested too deep");
+    luaL_checkstack(L, 3, "json.parse");
+    R->p++;
+    jsonSkipSpace(R);
+    if (close == ']')
+        lua_createtable(L, jsonCount(R, close), 0);
+    else
+        lua_createtable(L, 0, jsonCount(R, close));
+    if (*R->p == close)
     {
-        switch (**c)
-        {
-        case '"':
-            if (*((*c) - 1) != '\\')
-                end = *c;
-            break;
-        case '\\':
-            switch (*((*c) + 1))
-            {
-            case '"':
-            case '\\':
-            case '/':
-            case 'b':
-            case 'f':
-            case 'n':
-            case 'r':
-            case 't':
-                minus++;
-                (*c)++;
-                break;
-            case 'u':
-                utf = fourhex2int(L, (*c) + 2);
-                if (utf < 128)
-                    minus += 5;
-                else if (utf < 2048)
-                    minus += 4;
-                else
-                    minus += 3;
-                (*c) += 5;
-                break;
-            default:
-                JSONError(L, "invalid escape character");
-                break;
-            }
-        default:
-            break;
-        }
-        (*c)++;
-    }
-    *c = beginning;
-    char * newstr = NULL;
-    size_t len = sizeof(char) * (end - beginning - minus);
-    newstr = malloc(len+1);
-    memset(newstr, 0, len+1);
-    char * newc = newstr;
-    char * nextEscape = NULL;
-    char utfbuf[4] = "";
-    while (*c != end)
-    {
-        nextEscape = strchr(*c, '\\');
-        if (nextEscape > end)
-            nextEscape = NULL;
-        if (nextEscape == *c)
-        {
-            switch (*((*c) + 1))
-            {
-            case '"':
-                *newc = '"';
-                newc++;
-                (*c) += 2;
-                break;
-            case '\\':
-                *newc = '\\';
-                newc++;
-                (*c) += 2;
-                break;
-            case '/':
-                *newc = '/';
-                newc++;
-                (*c) += 2;
-                break;
-            case 'b':
-                *newc = '\b';
-                newc++;
-                (*c) += 2;
-                break;
-            case 'f':
-                *newc = '\f';
-                newc++;
-                (*c) += 2;
-                break;
-            case 'n':
-                *newc = '\n';
-                newc++;
-                (*c) += 2;
-                break;
-            case 'r':
-                *newc = '\r';
-                newc++;
-                (*c) += 2;
-                break;
-            case 't':
-                *newc = '\t';
-                newc++;
-                (*c) += 2;
-                break;
-            case 'u':
-                code2utf8(L, (*c) + 2, utfbuf);
-                size_t len = strlen(utfbuf);
-                strcpy(newc, utfbuf);
-                newc += len;
-                (*c) += 6;
-                break;
-            default:
-                JSONError(L, "invalid escape character");
-                break;
-            }
-        }
-        else if (nextEscape != NULL)
+        R->p++;
+        R->depth--;
+        return;
+    }
+    for (i = 1; ; i++)
+    {
+        if (close == ']')
         {
-            size_t len = nextEscape - *c;
-            strncpy(newc, *c, len);
-            newc += len;
-            (*c) += len;
+            jsonReadValue(R);
+            lua_rawseti(L, -2, i);
         }
         else
         {
-            size_t len = end - *c;
-            strncpy(newc, *c, len);
-            newc += len;
-            (*c) += len;
+            if (*R->p != '"')
+                jsonParseError(R, "expected a key");
+            jsonReadString(R);
+            jsonSkipSpace(R);
+            if (*R->p != ':')
+                jsonParseError(R, "expected ':'");
+            R->p++;
+            jsonSkipSpace(R);
+            jsonReadValue(R);
+            lua_rawset(L, -3);
         }
+        jsonSkipSpace(R);
+        if (*R->p == close)
+            break;
+        if (*R->p != ',')
+            jsonParseError(R, close == ']' ? "expected ',' or ']'" : "expected ',' or '}'");
+        R->p++;
+        jsonSkipSpace(R);
     }
-    *newc = 0;
-    lua_pushlstring(L, newstr, strlen(newstr));
-    (*c)++;
-    free(newstr);
+    R->p++;
+    R->depth--;
 }
 
-void readTrue(lua_State *L, char * str, char ** c)
+static void jsonLiteral(JSONReader *R, const char *word, size_t len)
 {
-    if (!strncmp(*c, "true", 4))
-    {
-        lua_pushboolean(L, 1);
-        *c += 4;
-    }
-    else
-        JSONError(L, "JSON readTrue b0rked :c.");
+    if (strncmp(R->p, word, len) != 0)
+        jsonParseError(R, "unexpected character");
+    R->p += len;
 }
 
-void readValue(lua_State *L, char * str, char ** c)
+/// Pushes the value at R->p. A null is the light userdata NULL (json.null
+/// in the web server), which json.stringify writes back as null.
+static void jsonReadValue(JSONReader *R)
 {
-    switch (**c)
+    switch (*R->p)
     {
-    case 'f':
-        readFalse(L, str, c);
+    case '{':
+    case '[':
+        jsonReadTable(R);
         break;
-    case 'n':
-        readNull(L, str, c);
+    case '"':
+        jsonReadString(R);
         break;
     case 't':
-        readTrue(L, str, c);
-        break;
-    case '[':
-        readArray(L, str, c);
-        break;
-    case '{':
-        readObject(L, str, c);
+        jsonLiteral(R, "true", 4);
+        lua_pushboolean(R->L, 1);
         break;
-    case '-':
-    case '0':
-    case '1':
-    case '2':
-    case '3':
-    case '4':
-    case '5':
-    case '6':
-    case '7':
-    case '8':
-    case '9':
-        readNumber(L, str, c);
+    case 'f':
+        jsonLiteral(R, "false", 5);
+        lua_pushboolean(R->L, 0);
         break;
-    case '"':
-        readString(L, str, c);
+    case 'n':
+        jsonLiteral(R, "null", 4);
+        lua_pushlightuserdata(R->L, NULL);
         break;
     default:
-        JSONError(L, strcat(*c, "JSON readValue b0rked :c."));
-        lua_error(L);
+        if (*R->p == '-' || (*R->p >= '0' && *R->p <= '9'))
+            jsonReadNumber(R);
+        else
+            jsonParseError(R, R->p == R->end ? "unexpected end" : "unexpected character");
         break;
     }
 }
 
+/// Pushes the value of the text of len bytes, followed by a '\0'. The
+/// strings with escapes are decoded in the text itself if inplace.
+void JSON_parse_text(lua_State *L, char *text, size_t len, int inplace)
+{
+    JSONReader R;
+
+    R.L = L;
+    R.text = text;
+    R.end = text + len;
+    R.p = text;
+    R.inplace = inplace;
+    R.depth = 0;
+    jsonSkipSpace(&R);
+    jsonReadValue(&R);
+    jsonSkipSpace(&R);
+    if (R.p != R.end)
+        jsonParseError(&R, "text after the value");
+}
+
 int JSON_parse(lua_State *L)
 {
-    char * str = NULL;
-    size_t str_size = 0;
-    if (lua_isuserdata(L, 1))
-        str = (char *)lua_touserdata(L, 1);
-    else
-    {
-        const char * sTmp = luaL_checklstring(L, 1, &str_size);
-        str = (char *)malloc(str_size + 1);
-        memcpy(str, sTmp, str_size);
-        str[str_size] = 0;
-    }
+    size_t len;
+    const char *text = luaL_checklstring(L, 1, &len);
 
-    char * c = str;
-    passwhitespace(L, &c);
-    readValue(L, str, &c);
-    passwhitespace(L, &c);
-    if (*c != 0)
-        JSONError(L, "Something past the root value?");
-    free(str);
+    // a Lua string is not written, but it always ends with a '\0'
+    JSON_parse_text(L, (char *)text, len, 0);
     return 1;
 }
-#endif
+
 // ~~~ STRINGIFY ~~~
 
-char int2digit(const int val)
+// The text is written in a buffer on the C stack. When it is full, its
+// content goes to a table of pieces in the calling state, joined at the
+// end: a document smaller than the buffer costs a single string and no
+// other allocation.
+
+#define JSON_PIECES 2       // stack slot of the table of full buffers
+
+typedef struct
 {
-    if (val >= 10)
-        return 'a' + val - 10;
-    else
-        return '0' + val;
-}
+    lua_State *L;
+    int npieces;
+    int depth;
+    const void *path[JSON_MAX_DEPTH];   // tables being written, to find cycles
+    size_t len;
+    char buf[LUAL_BUFFERSIZE];
+} JSONBuffer;
 
-void int2fourhex(int num, char * buf)
+static void jsonFlush(JSONBuffer *B)
 {
-    buf[0] = int2digit(num / 4096);
-    num %= 4096;
-    buf[1] = int2digit(num / 256);
-    num %= 256;
-    buf[2] = int2digit(num / 16);
-    num %= 16;
-    buf[3] = int2digit(num);
-    buf[4] = 0;
+    lua_State *L = B->L;
+
+    if (B->npieces == 0)
+    {
+        lua_newtable(L);
+        lua_replace(L, JSON_PIECES);
+    }
+    lua_pushlstring(L, B->buf, B->len);
+    lua_rawseti(L, JSON_PIECES, ++B->npieces);
+    B->len = 0;
 }
 
-char * quote(const char * S, int len)
+static void jsonAdd(JSONBuffer *B, const char *s, size_t len)
 {
-    const char * c = S;
-    int count = 2 + len;    // final string size, excluding zero terminator
-    while (c < S + len)
+    size_t n;
+
+    while (len > 0)
     {
-        switch (*c)
-        {
-        case '\\':
-        case '"':
-        case '\b':
-        case '\f':
-        case '\n':
-        case '\r':
-        case '\t':
-            count++;
-            break;
-        default:
-            if (*c < 32)
-                count += 5;
-            break;
-        }
-        c++;
-    }
-    // count complete, allocate and recreate string.
-    char * newS = malloc(sizeof(char) * (count + 1)); // add null terminator
-    char * newc = newS;
-    newc[0] = '"';
-    newc[1] = 'a';
-    newc[2] = 'b';
-    newc[3] = 'c';
-    newc++;
-    c = S;
-    while (c < S + len)
-    {
-        switch (*c)
-        {
-        case '\\':
-            newc[0] = '\\';
-            newc[1] = '\\';
-            newc += 2;
-            break;
-        case '"':
-            newc[0] = '\\';
-            newc[1] = '"';
-            newc += 2;
-            break;
-        case '\b':
-            newc[0] = '\\';
-            newc[1] = 'b';
-            newc += 2;
-            break;
-        case '\f':
-            newc[0] = '\\';
-            newc[1] = 'f';
-            newc += 2;
-            break;
-        case '\n':
-            newc[0] = '\\';
-            newc[1] = 'n';
-            newc += 2;
-            break;
-        case '\r':
-            newc[0] = '\\';
-            newc[1] = 'r';
-            newc += 2;
-            break;
-        case '\t':
-            newc[0] = '\\';
-            newc[1] = 't';
-            newc += 2;
-            break;
-        default:
-            if (*c < 32)
-            {
-                newc[0] = '\\';
-                newc[1] = 'u';
-                newc += 2;
-                int2fourhex(*c, newc);
-                newc += 4;
-            }
-            else
-            {
-                newc[0] = *c;
-                newc++;
-            }
-            break;
-        }
-        c++;
+        if (B->len == sizeof(B->buf))
+            jsonFlush(B);
+        n = sizeof(B->buf) - B->len;
+        if (n > len)
+            n = len;
+        memcpy(B->buf + B->len, s, n);
+        B->len += n;
+        s += n;
+        len -= n;
     }
-    newc[0] = '"';
-    newc[1] = 0;
-    return newS;
 }
 
-typedef struct {void * value; struct s_linkedList * next;} linkedList;
+static void jsonAddChar(JSONBuffer *B, char c)
+{
+    if (B->len == sizeof(B->buf))
+        jsonFlush(B);
+    B->buf[B->len++] = c;
+}
+
+/// The escape sequence of c in esc, for the characters that need one:
+/// the quote, the backslash and the control characters. Returns its length.
+static size_t jsonEscape(unsigned char c, char esc[6])
+{
+    static const char hex[] = "0123456789abcdef";
+
+    esc[0] = '\\';
+    switch (c)
+    {
+    case '"':  esc[1] = '"'; return 2;
+    case '\\': esc[1] = '\\'; return 2;
+    case '\b': esc[1] = 'b'; return 2;
+    case '\f': esc[1] = 'f'; return 2;
+    case '\n': esc[1] = 'n'; return 2;
+    case '\r': esc[1] = 'r'; return 2;
+    case '\t': esc[1] = 't'; return 2;
+    }
+    esc[1] = 'u';
+    esc[2] = '0';
+    esc[3] = '0';
+    esc[4] = hex[c >> 4];
+    esc[5] = hex[c & 15];
+    return 6;
+}
 
-void freeList(linkedList *L)
+#define jsonPlain(c) ((c) >= 32 && (c) != '"' && (c) != '\\')
+
+/// Quoted and escaped in one pass: the runs of plain characters are copied
+/// as they are.
+static void jsonAddString(JSONBuffer *B, const char *s, size_t len)
 {
-    if (L == NULL)
-        return;
-    linkedList * ptr = (linkedList *)L->next;
-    free(L);
-    freeList(ptr);
+    const char *end = s + len;
+    const char *run = s;
+    char esc[6];
+
+    jsonAddChar(B, '"');
+    for (; s < end; s++)
+    {
+        if (jsonPlain((unsigned char)*s))
+            continue;
+        jsonAdd(B, run, s - run);
+        run = s + 1;
+        jsonAdd(B, esc, jsonEscape((unsigned char)*s, esc));
+    }
+    jsonAdd(B, run, s - run);
+    jsonAddChar(B, '"');
 }
 
-void addToList(void * Value, linkedList * L)
+/// The text of n, written at the end of s: integers without sprintf, NaN
+/// and infinities as null.
+static const char *jsonNumber(lua_Number n, char s[LUAI_MAXNUMBER2STR], size_t *len)
 {
-    if (L == NULL)
+    char *p = s + LUAI_MAXNUMBER2STR;
+    unsigned long u;
+
+    if (n - n != 0)
     {
-        L = malloc(sizeof(linkedList));
-        L->value = Value;
-        L->next = NULL;
+        *len = 4;
+        return "null";
     }
-    else
+    if (n > -2147483648.0 && n < 2147483648.0 && n == (lua_Number)(long)n)
     {
-        if (L->next != NULL)
-        {
-            addToList(Value, (linkedList *)L->next);
-        }
-        else
+        u = n < 0 ? -(long)n : (long)n;
+        do
         {
-            linkedList * newL = (linkedList *)malloc(sizeof(linkedList));
-            L->next = (struct s_linkedList *)newL;
-            newL->value = Value;
-            newL->next = NULL;
-        }
-    }
+            *--p = '0' + u % 10;
+            u /= 10;
+        } while (u > 0);
+        if (n < 0)
+            *--p = '-';
+        *len = s + LUAI_MAXNUMBER2STR - p;
+        return p;
+    }
+    *len = lua_number2str(s, n);
+    return s;
 }
 
-linkedList * findInList(linkedList * L, void * Match)
+static void jsonAddNumber(JSONBuffer *B, lua_Number n)
 {
-    linkedList * ptr;
-    linkedList * match = NULL;
-    for (ptr = L; ptr != NULL; ptr = (linkedList *)ptr->next)
-    {
-        if (ptr->value == Match)
-        {
-            match = ptr;
-            break;
-        }
-    }
-    return match;
+    char s[LUAI_MAXNUMBER2STR];
+    size_t len;
+    const char *p = jsonNumber(n, s, &len);
+
+    jsonAdd(B, p, len);
 }
 
-void removeLastFromList(linkedList * L, linkedList * Last)
+static void jsonAddValue(JSONBuffer *B);
+
+/// Takes a table at the top of the stack: an array if t[1] is set, else
+/// an object of its string and number keys.
+static void jsonAddTable(JSONBuffer *B)
 {
-    if (L == NULL)
+    lua_State *L = B->L;
+    const void *t = lua_topointer(L, -1);
+    int i;
+
+    for (i = 0; i < B->depth; i++)
     {
-        return;
+        if (B->path[i] == t)
+            luaL_error(L, "json.stringify: recursive table");
     }
-    if (L->next == NULL)
+    if (B->depth == JSON_MAX_DEPTH)
+        luaL_error(L, "json.stringify: tables nested too deep");
+    B->path[B->depth++] = t;
+    luaL_checkstack(L, 3, "json.stringify");
+
+    lua_rawgeti(L, -1, 1);
+    if (!lua_isnil(L, -1))
     {
-        free(L);
-        if (Last != NULL)
+        jsonAddChar(B, '[');
+        for (i = 2; ; i++)
         {
-            Last->next = NULL;
+            jsonAddValue(B);    // -1 +0
+            lua_rawgeti(L, -1, i);
+            if (lua_isnil(L, -1))
+                break;
+            jsonAddChar(B, ',');
         }
+        lua_pop(L, 1);
+        jsonAddChar(B, ']');
     }
     else
-        removeLastFromList((linkedList *)L->next, L);
+    {
+        lua_pop(L, 1);
+        jsonAddChar(B, '{');
+        i = 0;
+        lua_pushnil(L);
+        while (lua_next(L, -2))
+        {
+            if (lua_type(L, -2) == LUA_TSTRING || lua_type(L, -2) == LUA_TNUMBER)
+            {
+                if (i++ > 0)
+                    jsonAddChar(B, ',');
+                if (lua_type(L, -2) == LUA_TSTRING)
+                {
+                    size_t len;
+                    const char *s = lua_tolstring(L, -2, &len);
+                    jsonAddString(B, s, len);
+                }
+                else
+                {
+                    // a copy: lua_tolstring would change the key of lua_next
+                    jsonAddChar(B, '"');
+                    jsonAddNumber(B, lua_tonumber(L, -2));
+                    jsonAddChar(B, '"');
+                }
+                jsonAddChar(B, ':');
+                jsonAddValue(B);    // -1 +0
+            }
+            else
+                lua_pop(L, 1);
+        }
+        jsonAddChar(B, '}');
+    }
+    B->depth--;
 }
 
-linkedList * baseList;
-
-/// -0 +0
-void stringifyBoolean(lua_State *L, const int value, luaL_Buffer *StringBuf)
+/// Takes the value at the top of the stack, and appends it to B.
+/// -1 +0
+static void jsonAddValue(JSONBuffer *B)
 {
-    luaL_addstring(StringBuf, value?"true":"false");
+    lua_State *L = B->L;
+    size_t len;
+    const char *s;
+
+    switch (lua_type(L, -1))
+    {
+    case LUA_TBOOLEAN:
+        if (lua_toboolean(L, -1))
+            jsonAdd(B, "true", 4);
+        else
+            jsonAdd(B, "false", 5);
+        break;
+    case LUA_TNUMBER:
+        jsonAddNumber(B, lua_tonumber(L, -1));
+        break;
+    case LUA_TSTRING:
+        s = lua_tolstring(L, -1, &len);
+        jsonAddString(B, s, len);
+        break;
+    case LUA_TTABLE:
+        jsonAddTable(B);
+        break;
+    default:
+        // nil, functions, userdata: no JSON for them
+        jsonAdd(B, "null", 4);
+        break;
+    }
+    lua_pop(L, 1);
 }
 
-/// -0 +0
-void stringifyNull(lua_State *L, luaL_Buffer *StringBuf)
+int JSON_stringify(lua_State *L)
 {
-    luaL_addstring(StringBuf, "null");
+    JSONBuffer B;
+    int i;
+
+    B.L = L;
+    B.npieces = 0;
+    B.depth = 0;
+    B.len = 0;
+    lua_settop(L, 1);   // Only take the first argument.
+    lua_pushnil(L);     // JSON_PIECES
+    lua_pushvalue(L, 1);
+    jsonAddValue(&B);   // -1 +0
+    if (B.npieces == 0)
+    {
+        lua_pushlstring(L, B.buf, B.len);
+        return 1;
+    }
+    luaL_checkstack(L, B.npieces + 1, "json.stringify: document too big");
+    for (i = 1; i <= B.npieces; i++)
+        lua_rawgeti(L, JSON_PIECES, i);
+    lua_pushlstring(L, B.buf, B.len);
+    lua_concat(L, B.npieces + 1);
+    return 1;
 }
 
-/// -0 +0
-void stringifyNumber(lua_State *L, const double value, luaL_Buffer *StringBuf)
+// ~~~ WRITE ~~~
+
+// The same text, written a piece at a time in the buffers given to
+// JSON_write_step(), so that a document is sent as it is made. The walk of
+// the tables is shared with the other formats (cbor), which give their own
+// JSONFormat. The state is on the stack of L: the writer, then for each
+// table being written the table and its last key (the last index of an
+// array), then the value being written. Nothing is copied but the text of
+// a number.
+
+#define JW_VALUE 0      // the value at the top is next
+#define JW_KEY 1        // the key of the member at the top is next
+#define JW_COLON 2      // its separator is next
+#define JW_NEXT 3       // the next element of the table at the top
+
+#define JW_ARRAY 0      // JSONWriter.kind
+#define JW_OBJECT 1     // an object without any member written yet
+#define JW_MEMBERS 2    // an object with its first member written
+
+int JSON_put(JSONOut *o, const char *s, size_t len)
 {
-    char s[32];
-    sprintf(s, "%.14g", value);
-    luaL_addstring(StringBuf, s);
+    if ((size_t)(o->end - o->p) < len)
+        return 0;
+    memcpy(o->p, s, len);
+    o->p += len;
+    return 1;
 }
 
-/// -0 +0
-void stringifyString(lua_State *L, const char * S, const int len, luaL_Buffer *StringBuf)
+/// A number, in quotes for a key. Returns 0 if it does not fit.
+static int jsonPutNumber(JSONOut *o, lua_Number n, int quoted)
 {
-    char * quote_s = quote(S, len);
-    luaL_addstring(StringBuf, quote_s);
-    free(quote_s);
-}
+    char s[LUAI_MAXNUMBER2STR];
+    size_t len;
+    const char *p = jsonNumber(n, s, &len);
 
-void stringify(lua_State *L, luaL_Buffer *StringBuf);
+    if ((size_t)(o->end - o->p) < len + 2 * quoted)
+        return 0;
+    if (quoted)
+        *o->p++ = '"';
+    JSON_put(o, p, len);
+    if (quoted)
+        *o->p++ = '"';
+    return 1;
+}
 
-/// Takes a table at the top of the stack, and appends it, stringified, to StringBuf.
-void stringifyTable(lua_State *L, luaL_Buffer *StringBuf)
+/// Writes what fits of a string, from W->off on. Returns 1 once its
+/// closing quote is out.
+static int jsonPutString(JSONWriter *W, JSONOut *o, const char *s, size_t len)
 {
-    void * tablePtr = (void *)lua_topointer(L, -1); // -0 +0
-    linkedList * foundMatch = findInList(baseList, tablePtr);
-    if (!foundMatch)
+    char esc[6];
+    size_t i, n;
+
+    if (W->off == 0)
     {
-        addToList(tablePtr, baseList);
-        lua_checkstack(L, 6);
-        lua_pushnumber(L, 1); // -0 +1
-        lua_gettable(L, -2);  // -1 +1
-        if (lua_isnil(L, -1))   // No t[1], treat as object.
-        {
-            lua_pop(L, 1);  // -1 +0
-            luaL_addchar(StringBuf, '{');
-            lua_getglobal(L, "pairs"); // -0 +1
-            lua_pushvalue(L, -2);   // -0 +1
-            lua_call(L, 1, 3);  // -2 +3 pairs(t), three return-values put on stack
-            BOOL first = TRUE;
-            while (1)
-            {
-                lua_pushvalue(L, -3);   // -0 +1
-                lua_pushvalue(L, -3);   // -0 +1
-                lua_pushvalue(L, -3);   // -0 +1
-                lua_remove(L, -4);   // -1 +0
-                lua_call(L, 2, 2);  // -3 +2 calling the iterator function, getting key,value
-                if (lua_isnil(L, -2))
-                {
-                    lua_pop(L, 4); // -4+0
-                    break;
-                }
-                else if (!lua_isstring(L, -2))
-                {
-                    lua_pop(L, 1); // -1+0
-                    continue;
-                }
-                if (!first)
-                    luaL_addchar(StringBuf, ',');
-                else
-                    first = FALSE;
-                lua_pushvalue(L, -2);   // -0 +1
-                stringify(L, StringBuf); // -1 +0
-                luaL_addchar(StringBuf, ':');   // -0 +0
-                stringify(L, StringBuf); // -1 +0
-            }
-            luaL_addchar(StringBuf, '}');
-        }
-        else    // t[1] exists, treat as array.
-        {
-            lua_pop(L, 1);  // -1 +0
-            luaL_addchar(StringBuf, '[');
-            lua_getglobal(L, "ipairs"); // -0+1
-            lua_pushvalue(L, -2);   // -0+1
-            lua_call(L, 1, 3);  // -2+3 ipairs(t), three return-values put on stack
-            BOOL first = TRUE;
-            while (1)
-            {
-                lua_pushvalue(L, -3);   // -0+1
-                lua_pushvalue(L, -3);   // -0+1
-                lua_pushvalue(L, -3);   // -0+1
-                lua_remove(L, -4);   // -1+0
-                lua_call(L, 2, 2);  // -3+2 calling the iterator function, getting key,value
-                if (lua_isnil(L, -2))
-                {
-                    lua_pop(L, 4); // -4+0
-                    break;
-                }
-                if (!first)
-                    luaL_addchar(StringBuf, ',');
-                else
-                    first = FALSE;
-                stringify(L, StringBuf); // -1 +0
-            }
-            luaL_addchar(StringBuf, ']');
-        }
-        removeLastFromList(baseList, NULL);
+        if (o->p == o->end)
+            return 0;
+        *o->p++ = '"';
+        W->off = 1;
     }
-    else
+    for (i = W->off - 1; i < len && o->p < o->end; i++)
     {
-        printf("RECURSION\n");
-        luaL_addstring(StringBuf, "RECURSION");
+        if (jsonPlain((unsigned char)s[i]))
+            *o->p++ = s[i];
+        else if ((n = jsonEscape((unsigned char)s[i], esc)) > (size_t)(o->end - o->p))
+            break;
+        else
+            JSON_put(o, esc, n);
     }
+    W->off = i + 1;
+    if (i < len || o->p == o->end)
+        return 0;
+    *o->p++ = '"';
+    W->off = 0;
+    return 1;
 }
 
-/// Takes the value at the top of L's stack, and appends it to StringBuf.
-/// -1 +0
-void stringify(lua_State *L, luaL_Buffer *StringBuf)
+/// The scalars of JSON: a number key goes in quotes.
+static int jsonScalar(JSONWriter *W, lua_State *L, int idx, JSONOut *o, int key)
 {
-    if (lua_isboolean(L, -1))
+    size_t len;
+    const char *s;
+
+    switch (lua_type(L, idx))
     {
-        int B = lua_toboolean(L, -1);   // -0 +0
-        stringifyBoolean(L, B, StringBuf);  // -0 +0
+    case LUA_TBOOLEAN:
+        return lua_toboolean(L, idx) ? JSON_put(o, "true", 4) : JSON_put(o, "false", 5);
+    case LUA_TNUMBER:
+        return jsonPutNumber(o, lua_tonumber(L, idx), key);
+    case LUA_TSTRING:
+        s = lua_tolstring(L, idx, &len);
+        return jsonPutString(W, o, s, len);
+    default:
+        return JSON_put(o, "null", 4);
     }
-    else if (lua_isnumber(L, -1))
+}
+
+const JSONFormat JSON_text = { '[', ']', '{', '}', ',', ':', jsonScalar };
+
+/// Opens the table at the top of the stack, which stays there with its
+/// first key. Returns 0 if it does not fit.
+static int jsonOpenTable(JSONWriter *W, lua_State *L, JSONOut *o)
+{
+    int i;
+
+    if (o->p == o->end)
+        return 0;
+    for (i = 0; i < W->depth; i++)
     {
-        double N = lua_tonumber(L, -1); // -0 +0
-        stringifyNumber(L, N, StringBuf);   // -0 +0
+        if (lua_rawequal(L, W->base + 1 + 2 * i, -1))
+        {
+            W->err = "recursive table";
+            return 1;
+        }
     }
-    else if (lua_isstring(L, -1))
+    if (W->depth == JSON_MAX_DEPTH || !lua_checkstack(L, 3))
     {
-    	size_t len;
-        const char * s = lua_tolstring(L, -1, &len);    // -0 +0
-        stringifyString(L, s, len, StringBuf);  // -0 +0
+        W->err = "tables nested too deep";
+        return 1;
     }
-    else if (lua_istable(L, -1))
+    lua_rawgeti(L, -1, 1);
+    W->kind[W->depth++] = lua_isnil(L, -1) ? JW_OBJECT : JW_ARRAY;
+    lua_pop(L, 1);
+    if (W->kind[W->depth - 1] == JW_ARRAY)
     {
-        lua_checkstack(L, 2);
-        lua_getglobal(L, "json");   // -0 +1
-        lua_getfield(L, -1, "null");    // -0 +1
-        if (lua_equal(L, -3, -1))
-        {
-            lua_pop(L, 2);  // -2 +0
-            stringifyNull(L, StringBuf);    // -0 +0
-        }
-        else
+        *o->p++ = W->fmt->open_array;
+        lua_pushinteger(L, 0);
+    }
+    else
+    {
+        *o->p++ = W->fmt->open_object;
+        lua_pushnil(L);
+    }
+    W->phase = JW_NEXT;
+    return 1;
+}
+
+/// The next element of the table being written, or its end.
+static int jsonNextElement(JSONWriter *W, lua_State *L, JSONOut *o)
+{
+    char *kind = &W->kind[W->depth - 1];
+    int i;
+
+    if (o->p == o->end)
+        return 0;
+    if (*kind == JW_ARRAY)
+    {
+        i = (int)lua_tointeger(L, -1) + 1;
+        lua_rawgeti(L, -2, i);
+        if (!lua_isnil(L, -1))
         {
-            lua_pop(L, 2);  // -2 +0
-            stringifyTable(L, StringBuf);   // -0 +0
+            lua_pushinteger(L, i);
+            lua_replace(L, -3);
+            if (i > 1 && W->fmt->comma)
+                *o->p++ = W->fmt->comma;
+            W->phase = JW_VALUE;
+            return 1;
         }
+        lua_pop(L, 3);
+        *o->p++ = W->fmt->close_array;
     }
     else
     {
-        if (lua_isfunction(L, -1))
-            luaL_addstring(StringBuf, "FUNCTION");
-        else if (lua_isuserdata(L, -1))
-            luaL_addstring(StringBuf, "USERDATA");
-        else if (lua_isnil(L, -1))
-            luaL_addstring(StringBuf, "");
-        else
-            luaL_addstring(StringBuf, "wtf?");
+        while (lua_next(L, -2))
+        {
+            if (lua_type(L, -2) == LUA_TSTRING || lua_type(L, -2) == LUA_TNUMBER)
+            {
+                if (*kind == JW_MEMBERS && W->fmt->comma)
+                    *o->p++ = W->fmt->comma;
+                *kind = JW_MEMBERS;
+                W->phase = JW_KEY;
+                return 1;
+            }
+            lua_pop(L, 1);
+        }
+        lua_pop(L, 1);
+        *o->p++ = W->fmt->close_object;
     }
-    lua_pop(L, 1); // -1 +0
+    W->depth--;
+    return 1;
 }
 
-int JSON_stringify(lua_State *L)
+/// Starts writing the value at the top of the stack in fmt: the writer
+/// goes just below it.
+void JSON_write_begin(lua_State *L, const JSONFormat *fmt)
 {
-    lua_State * Strings = lua_open(); // Lua state which will hold the string buffer stack.
-    luaL_Buffer * LBuf = malloc(sizeof(luaL_Buffer));
-    luaL_buffinit(Strings, LBuf); // This one.
-    lua_settop(L, 1);   // Only take the first argument.
-    stringify(L, LBuf); // -1 +0
-    luaL_pushresult(LBuf);  // -0 +1
-    free(LBuf);
-    lua_xmove(Strings, L, 1);   // Move the finished string to the main state.
-    lua_close(Strings);
+    JSONWriter *W = (JSONWriter *)lua_newuserdata(L, sizeof(JSONWriter));
+
+    W->fmt = fmt;
+    W->base = lua_gettop(L) - 1;
+    W->depth = 0;
+    W->phase = JW_VALUE;
+    W->off = 0;
+    W->err = NULL;
+    lua_insert(L, -2);
+}
+
+/// Writes the bytes that follow in out, up to size, their number in *len.
+/// The writer is at idx, the top of the stack is its own. Returns 1 when
+/// the document is complete, with *err set if it was cut short (a
+/// recursive table, tables nested too deep); the stack is then back below
+/// idx. The tables must not change while they are written.
+int JSON_write_step(lua_State *L, int idx, char *out, size_t size, size_t *len, const char **err)
+{
+    JSONWriter *W = (JSONWriter *)lua_touserdata(L, idx);
+    JSONOut o;
+    int more = 1;
+
+    o.p = out;
+    o.end = out + size;
+    while (more && W->err == NULL)
+    {
+        switch (W->phase)
+        {
+        case JW_VALUE:
+            if (lua_type(L, -1) == LUA_TTABLE)
+                more = jsonOpenTable(W, L, &o);
+            else if ((more = W->fmt->scalar(W, L, -1, &o, 0)))
+            {
+                lua_pop(L, 1);
+                W->phase = JW_NEXT;
+            }
+            break;
+        case JW_KEY:
+            if ((more = W->fmt->scalar(W, L, -2, &o, 1)))
+                W->phase = W->fmt->colon ? JW_COLON : JW_VALUE;
+            break;
+        case JW_COLON:
+            if ((more = JSON_put(&o, &W->fmt->colon, 1)))
+                W->phase = JW_VALUE;
+            break;
+        default:
+            if (W->depth == 0)
+            {
+                *len = o.p - out;
+                *err = NULL;
+                lua_settop(L, idx - 1);
+                return 1;
+            }
+            more = jsonNextElement(W, L, &o);
+            break;
+        }
+    }
+    *len = o.p - out;
+    if (W->err == NULL)
+        return 0;
+    *err = W->err;
+    lua_settop(L, idx - 1);
     return 1;
 }
 
@@ -937,9 +937,7 @@ int JSON_stringify(lua_State *L)
 #include "lrodefs.h"
 const LUA_REG_TYPE json_map[] =
 {
-#ifdef JSON_PARSE
   { LSTRKEY( "parse" ), LFUNCVAL( JSON_parse ) },
-#endif
   { LSTRKEY( "stringify" ), LFUNCVAL( JSON_stringify ) },
   { LNILKEY, LNILVAL }
 };
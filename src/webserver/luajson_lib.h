@@ -0,0 +1,58 @@
+#ifndef __LUAJSON_LIB_H__
+#define __LUAJSON_LIB_H__
+
+#include <stddef.h>
+#include <lua.h>
+
+int  JSON_parse(lua_State *L);
+int  JSON_stringify(lua_State *L);
+
+/* Pushes the value of the text of len bytes, which must be followed by a
+   '\0'; with inplace, the strings are decoded in the text itself */
+void JSON_parse_text(lua_State *L, char *text, size_t len, int inplace);
+
+/* Tables inside tables, in a document read or written */
+#define JSON_MAX_DEPTH 32
+
+/* A document written a piece at a time, in JSON or in another format:
+   JSON_write_begin() takes the value at the top of the stack of L, then
+   each JSON_write_step() writes the bytes that follow in out */
+
+typedef struct
+{
+    char *p;
+    char *end;
+} JSONOut;
+
+typedef struct JSONWriter JSONWriter;
+
+typedef struct
+{
+    /* the bytes opening and closing the tables, the separators after an
+       element and after a key (0 for none) */
+    char open_array, close_array, open_object, close_object;
+    char comma, colon;
+    /* writes the value at idx, which is not a table, a key if key is set;
+       0 if it does not fit. A string can be written in pieces: W->off
+       tells where the next one starts, 0 when it is not begun. */
+    int (*scalar)(JSONWriter *W, lua_State *L, int idx, JSONOut *o, int key);
+} JSONFormat;
+
+struct JSONWriter
+{
+    const JSONFormat *fmt;
+    int base;                       /* its stack index */
+    int depth;                      /* tables being written */
+    char kind[JSON_MAX_DEPTH];      /* array or object, for each */
+    char phase;
+    size_t off;
+    const char *err;
+};
+
+extern const JSONFormat JSON_text;
+
+void JSON_write_begin(lua_State *L, const JSONFormat *fmt);
+int  JSON_write_step(lua_State *L, int idx, char *out, size_t size, size_t *len, const char **err);
+int  JSON_put(JSONOut *o, const char *s, size_t len);
+
+#endif /* __LUAJSON_LIB_H__ */
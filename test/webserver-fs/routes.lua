@@ -0,0 +1,25 @@
+-- Run once when the web server starts, to set its routes
+
+-- the values of ajax.pht, pushed once a second as server-sent events
+httpd.route("/events", function(req, path)
+  local t = 0
+  while true do
+    t = t + 1
+    httpd.event("t(" .. t .. ");h(" .. t + 2 .. ");l(" .. t + 3 .. ");")
+    httpd.sleep(1000)
+  end
+end, "text/event-stream")
+
+-- the LED of index.pht without a request per click: "on" or "off" per
+-- message, the answer is the new state
+httpd.websocket("/led", function(msg)
+  if msg == "on" or msg == "off" then
+    if pio then
+      pio.pin.setdir(pio.OUTPUT, pio.PB_27)
+      if msg == "on" then pio.pin.setlow(pio.PB_27) else pio.pin.sethigh(pio.PB_27) end
+    end
+    print(msg)
+  else
+    print("unknown command " .. msg)
+  end
+end)
@@ -28,6 +28,41 @@ local function _add_data( data, outfile, moredata )
   end
 end
 
+-- Extensions of the files that get a gzip compressed copy (see 'gzip' below)
+gzip_ext = { ".html", ".htm", ".css", ".js", ".txt", ".json", ".svg", ".xml" }
+
+-- Write a file entry: name, size, data
+local function _add_file( fname, filedata, outfile )
+  for i = 1, #fname do
+    _add_data( fname:byte( i ), outfile )
+  end
+  _add_data( 0, outfile ) -- ASCIIZ
+  local plen = string.pack( "<h", #filedata )
+  _add_data( plen:byte( 1 ), outfile )
+  _add_data( plen:byte( 2 ), outfile )
+  -- Then write the rest of the file
+  for i = 1, #filedata do
+    _add_data( filedata:byte( i ), outfile )
+  end
+  -- Report
+  print( sf( "Encoded file %s (%d bytes)", fname, #filedata ) )
+end
+
+-- Return the gzip compressed 'realname' or nil if it is not smaller
+local function _gzip_file( realname, filedata )
+  local gzname = realname .. ".gz.tmp"
+  if os.execute( sf( 'gzip -9 -n -c "%s" > "%s"', realname, gzname ) ) ~= 0 then
+    os.remove( gzname )
+    return
+  end
+  local gzfile = io.open( gzname, "rb" )
+  if not gzfile then return end
+  local gzdata = gzfile:read( '*a' )
+  gzfile:close()
+  os.remove( gzname )
+  if #gzdata < #filedata then return gzdata end
+end
+
 -- dirname - the directory where the files are located.
 -- outname - the name of the C output
 -- flist - list of files
@@ -36,8 +71,11 @@ end
 --   "compile" - precompile all files to Lua bytecode and then copy them
 --   "compress" - keep the source code, but compress it with LuaSrcDiet
 -- compcmd - the command to use for compiling if "mode" is "compile"
+-- gzip - if true, the files with an extension in 'gzip_ext' are also
+--   stored gzip compressed as <name>.gz (served by the web server to the
+--   clients that accept it)
 -- Returns true for OK, false for error
-function mkfs( dirname, outname, flist, mode, compcmd )
+function mkfs( dirname, outname, flist, mode, compcmd, gzip )
   -- Try to create the output files
   local outfname = outname .. ".h"
   outfile = io.open( outfname, "wb" )
@@ -113,19 +151,18 @@ function mkfs( dirname, outname, flist, mode, compcmd )
           os.remove( newname )
         end
         -- Write name, size, id, numpars
-        for i = 1, #fname do
-          _add_data( fname:byte( i ), outfile )
-        end
-        _add_data( 0, outfile ) -- ASCIIZ
-        local plen = string.pack( "<h", #filedata )
-        _add_data( plen:byte( 1 ), outfile )
-        _add_data( plen:byte( 2 ), outfile )
-        -- Then write the rest of the file
-        for i = 1, #filedata do
-          _add_data( filedata:byte( i ), outfile )
+        _add_file( fname, filedata, outfile )
+        -- And the compressed copy if requested
+        if gzip and #fname + 3 <= maxlen then
+          local _, ext = utils.split_path( fname )
+          for _, v in pairs( gzip_ext ) do
+            if ext == v then
+              local gzdata = _gzip_file( realname, filedata )
+              if gzdata then _add_file( fname .. ".gz", gzdata, outfile ) end
+              break
+            end
+          end
         end
-        -- Report
-        print( sf( "Encoded file %s (%d bytes)", fname, #filedata ) )
       end
     end
   end